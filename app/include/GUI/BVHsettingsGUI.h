@@ -34,9 +34,11 @@ namespace BVH
 * @param displayed_layer - the layer of the BVH to display
 * @param display_multiple - whether to display multiple layers of the BVH (till the displayed layer)
 * @param was_IMGUI_input - whether there was IMGUI input (used in shader to tell when to restart the accumulation of rays)
+* @param run_query_benchmark - set when the shadow query benchmark should be run (BVH::benchmarkQueries)
+* @param query_benchmark_summary - the results of the last benchmark (empty until it was run)
 * @param disabled - to disable the GUI when in the camera control mode
 * */
-void BVH_settings_GUI(bool& display_BVH, BVH::Heuristic& active_heuristic, int BVH_tree_depth, int& heatmap_color_limit, bool& showPixelData, bool& was_IMGUI_input, bool disabled) {
+void BVH_settings_GUI(bool& display_BVH, BVH::Heuristic& active_heuristic, int BVH_tree_depth, int& heatmap_color_limit, bool& showPixelData, bool& was_IMGUI_input, bool& run_query_benchmark, const char* query_benchmark_summary, bool disabled) {
     ImGuiWindowFlags BVH_window_flags = 0;
     BVH_window_flags |= ImGuiWindowFlags_NoCollapse;
     BVH_window_flags |= ImGuiWindowFlags_NoTitleBar;
@@ -84,6 +86,23 @@ void BVH_settings_GUI(bool& display_BVH, BVH::Heuristic& active_heuristic, int B
         ImGui::EndTooltip();
     }
 
+    ImGui::SeparatorText("Shadow queries");
+    if (ImGui::Button("Benchmark any-hit vs closest-hit")) {
+        run_query_benchmark = true;
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::BeginItemTooltip())
+    {
+        ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+        ImGui::TextUnformatted("Traces the same visibility rays between random points of the mesh on the CPU, once with the closest-hit traversal and once with the any-hit occlusion query used by the shadow rays (single threaded, in the background).");
+        ImGui::PopTextWrapPos();
+        ImGui::EndTooltip();
+    }
+    if (query_benchmark_summary[0] != '\0') {
+        ImGui::TextUnformatted(query_benchmark_summary);
+    }
+
     ImGui::End();
 	if (disabled) { ImGui::EndDisabled(); }
 }
@@ -0,0 +1,34 @@
+#pragma once
+#include <imgui.h>
+
+#include "core/SceneLoader.h"
+
+/**
+* @brief Shows the progress of the background scene loading (hidden once the mesh is loaded)
+* @param sceneLoader - the loader to report on
+* */
+void genLoadingGUI(const SceneLoader& sceneLoader)
+{
+	if (!sceneLoader.IsLoading() && !sceneLoader.IsReady() && sceneLoader.GetStage() != SceneLoader::Stage::FAILED) {
+		return;
+	}
+
+	ImGui::Begin("Scene Loading", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize);
+
+	ImGui::TextUnformatted(sceneLoader.GetPath().c_str());
+	ImGui::Text("%s", sceneLoader.GetStageName());
+	ImGui::ProgressBar(sceneLoader.GetProgress(), ImVec2(300.0f, 0.0f));
+
+	double secondsLeft = sceneLoader.GetEstimatedSecondsLeft();
+	if (sceneLoader.GetStage() == SceneLoader::Stage::FAILED) {
+		ImGui::Text("The model could not be loaded");
+	}
+	else if (secondsLeft < 0.0) {
+		ImGui::Text("Elapsed: %.1f s (estimating...)", sceneLoader.GetElapsedSeconds());
+	}
+	else {
+		ImGui::Text("Elapsed: %.1f s, ETA: %.1f s", sceneLoader.GetElapsedSeconds(), secondsLeft);
+	}
+
+	ImGui::End();
+}
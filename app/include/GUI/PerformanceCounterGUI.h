@@ -1,7 +1,12 @@
 #pragma once
 #include <imgui.h>
 
-void genPerformanceCounter()
+/**
+* @brief Shows the frame time and the ray throughput
+* @param raysPerFrame - rays traced during a recent frame (Renderer::getRaysPerFrame)
+* @param raysPerSecond - throughput of the rtx stage alone (Renderer::getRaysPerSecond), 0 if not measured
+* */
+void genPerformanceCounter(unsigned int raysPerFrame, double raysPerSecond)
 {
 	ImGuiIO& io = ImGui::GetIO();
 	ImGui::Begin("FPS Counter", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDocking);
@@ -29,5 +34,9 @@ void genPerformanceCounter()
 		ImGui::EndTooltip();
 	}
 	ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+	ImGui::Text("%.1f Mrays/s (%u rays/frame)", raysPerFrame * io.Framerate / 1.0e6f, raysPerFrame);
+	if (raysPerSecond > 0.0) {
+		ImGui::Text("%.1f Mrays/s GPU (rtx stage only)", raysPerSecond / 1.0e6);
+	}
 	ImGui::End();
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include <imgui.h>
+#include <cfloat>
+
+#include "core/gl_util/GPUProfiler.h"
+#include "core/util/Profiler.h"
+
+/**
+* @brief Shows the GPU time of every profiled zone as a rolling graph and exports the history to CSV,
+* records the CPU zones (PROFILE_SCOPE) and exports them as a Chrome trace
+* @param profiler - the profiler of the renderer (Renderer::getProfiler)
+* */
+void genProfilerGUI(GPUProfiler& profiler)
+{
+	ImGui::Begin("Profiler");
+
+	ImGui::SeparatorText("CPU trace");
+#ifndef CORE_PROFILING
+	ImGui::TextDisabled("compiled without CORE_PROFILING");
+	ImGui::BeginDisabled();
+#endif
+	bool recording = Profiler::isRecording();
+	if (ImGui::Checkbox("Record", &recording)) {
+		Profiler::setRecording(recording);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear")) {
+		Profiler::clear();
+	}
+	static char tracePath[256] = "cpu_trace.json";
+	static bool traceExportFailed = false;
+	ImGui::InputText("##tracePath", tracePath, sizeof(tracePath));
+	ImGui::SameLine();
+	if (ImGui::Button("Export trace")) {
+		traceExportFailed = !Profiler::exportChromeTrace(tracePath);
+	}
+	if (traceExportFailed) {
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Failed to write %s", tracePath);
+	}
+#ifndef CORE_PROFILING
+	ImGui::EndDisabled();
+#endif
+
+	ImGui::SeparatorText("GPU");
+
+	static char csvPath[256] = "gpu_profile.csv";
+	static bool exportFailed = false;
+	ImGui::InputText("##csvPath", csvPath, sizeof(csvPath));
+	ImGui::SameLine();
+	if (ImGui::Button("Export CSV")) {
+		exportFailed = !profiler.ExportCSV(csvPath);
+	}
+	if (exportFailed) {
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Failed to write %s", csvPath);
+	}
+
+	ImGui::SeparatorText("ms per frame");
+	float graphWidth = ImGui::GetContentRegionAvail().x;
+	for (unsigned int zone = 0; zone < profiler.GetZoneCount(); zone++) {
+		const std::vector<float>& history = profiler.GetHistory(zone);
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%s: %.3f ms", profiler.GetZoneName(zone).c_str(), profiler.GetLatestMs(zone));
+
+		ImGui::PushID(zone);
+		ImGui::PlotLines("##zone", history.data(), (int)history.size(), profiler.GetHistoryOffset(), overlay, 0.0f, FLT_MAX, ImVec2(graphWidth, 40.0f));
+		ImGui::PopID();
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <imgui.h>
+
+#include "core/Renderer.h"
+
+/**
+* @brief Wrap code in an if statement and set imgui_was_input as true
+* @param code - the code to be wrapped
+*/
+#define IMGUI_INPUT(code) \
+    if (code) { \
+        was_IMGUI_input = true; \
+    }
+
+/**
+* @brief GUI for the settings of the renderer (how the rays are traced)
+* @param renderer - the renderer to configure
+* @param was_IMGUI_input - whether there was IMGUI input (restarts the accumulation of rays)
+* @param disabled - to disable the GUI when in the camera control mode
+* */
+void genRendererSettingsGUI(Renderer& renderer, bool& was_IMGUI_input, bool disabled)
+{
+	if (disabled) { ImGui::BeginDisabled(); }
+	ImGui::Begin("Renderer Settings");
+
+	ImGui::SeparatorText("Tracing mode");
+	int tracingMode = static_cast<int>(renderer.getTracingMode());
+	IMGUI_INPUT(ImGui::RadioButton("Megakernel", &tracingMode, static_cast<int>(TracingMode::MEGAKERNEL)));
+	ImGui::SameLine();
+	IMGUI_INPUT(ImGui::RadioButton("Wavefront", &tracingMode, static_cast<int>(TracingMode::WAVEFRONT)));
+	ImGui::SameLine();
+	IMGUI_INPUT(ImGui::RadioButton("Persistent threads", &tracingMode, static_cast<int>(TracingMode::PERSISTENT_THREADS)));
+	renderer.setTracingMode(static_cast<TracingMode>(tracingMode));
+
+	if (renderer.getTracingMode() == TracingMode::PERSISTENT_THREADS) {
+		int workGroups = static_cast<int>(renderer.getPersistentWorkGroups());
+		if (ImGui::SliderInt("Work groups", &workGroups, 1, 8192, "%d", ImGuiSliderFlags_Logarithmic)) {
+			renderer.setPersistentWorkGroups(static_cast<unsigned int>(workGroups));
+		}
+		ImGui::SameLine();
+		ImGui::TextDisabled("(?)");
+		if (ImGui::BeginItemTooltip()) {
+			ImGui::TextUnformatted("64 threads per group, tune for the highest Mrays/s\n(just enough groups to keep every compute unit busy)");
+			ImGui::EndTooltip();
+		}
+		ImGui::Text("Pixel batches per %s", renderer.hasSubgroupOps() ? "subgroup" : "work group (no subgroup support)");
+	}
+
+	ImGui::SeparatorText("Progressive rendering");
+	if (renderer.getTracingMode() != TracingMode::MEGAKERNEL) { ImGui::BeginDisabled(); }
+	bool adaptive = renderer.isAdaptiveSampling();
+	float errorThreshold = renderer.getErrorThreshold() * 100.0f;
+	int minFrames = static_cast<int>(renderer.getMinAccumulatedFrames());
+	IMGUI_INPUT(ImGui::Checkbox("Adaptive sampling", &adaptive));
+	ImGui::SliderFloat("Error threshold (%)", &errorThreshold, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+	ImGui::SliderInt("Min frames per pixel", &minFrames, 2, 64);
+	renderer.setAdaptiveSampling(adaptive, errorThreshold / 100.0f, static_cast<unsigned int>(minFrames));
+	if (adaptive) {
+		ImGui::Text("Active pixels: %u", renderer.getActivePixelCount());
+	}
+
+	if (adaptive) { ImGui::BeginDisabled(); }
+	bool tiled = renderer.isTiledRendering();
+	float frameBudgetMs = renderer.getFrameBudgetMs();
+	ImGui::Checkbox("Time budgeted tiles", &tiled);
+	ImGui::SliderFloat("GPU budget (ms/frame)", &frameBudgetMs, 1.0f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+	renderer.setTiledRendering(tiled, frameBudgetMs);
+	if (tiled) {
+		ImGui::Text("%u / %u tiles per frame", renderer.getTilesPerFrame(), renderer.getTileCount());
+	}
+	if (adaptive) { ImGui::EndDisabled(); }
+	if (renderer.getTracingMode() != TracingMode::MEGAKERNEL) { ImGui::EndDisabled(); }
+
+	ImGui::SeparatorText("Camera motion");
+	bool dynamicResolution = renderer.isDynamicResolution();
+	float targetFrameMs = renderer.getTargetFrameMs();
+	ImGui::Checkbox("Dynamic resolution", &dynamicResolution);
+	ImGui::SliderFloat("Target frame time (ms)", &targetFrameMs, 4.0f, 50.0f, "%.1f");
+	renderer.setDynamicResolution(dynamicResolution, targetFrameMs);
+	if (dynamicResolution) {
+		ImGui::Text("Resolution scale: %.0f%%", renderer.getResolutionScale() * 100.0f);
+	}
+
+	bool reprojection = renderer.isTemporalReprojection();
+	int maxHistoryFrames = static_cast<int>(renderer.getMaxHistoryFrames());
+	ImGui::Checkbox("Temporal reprojection", &reprojection);
+	ImGui::SliderInt("Max history frames", &maxHistoryFrames, 1, 256, "%d", ImGuiSliderFlags_Logarithmic);
+	renderer.setTemporalReprojection(reprojection, static_cast<unsigned int>(maxHistoryFrames));
+	ImGui::SameLine();
+	ImGui::TextDisabled("(?)");
+	if (ImGui::BeginItemTooltip()) {
+		ImGui::TextUnformatted("Keeps the accumulated samples while the camera moves (full frame modes only,\nthe resolution has to stay the same, so not together with the dynamic resolution)");
+		ImGui::EndTooltip();
+	}
+
+	ImGui::SeparatorText("Light sampling");
+	bool nextEventEstimation = renderer.isNextEventEstimation();
+	IMGUI_INPUT(ImGui::Checkbox("Next event estimation (MIS)", &nextEventEstimation));
+	renderer.setNextEventEstimation(nextEventEstimation);
+	ImGui::SameLine();
+	ImGui::TextDisabled("(?)");
+	if (ImGui::BeginItemTooltip()) {
+		ImGui::TextUnformatted("Every hit traces a shadow ray towards a random light (emissive sphere or triangle),\ncombined with the bounce rays by multiple importance sampling");
+		ImGui::EndTooltip();
+	}
+	ImGui::Text("Lights: %u", renderer.getLightCount());
+
+	ImGui::SeparatorText("Path termination");
+	bool russianRoulette = renderer.isRussianRoulette();
+	int rouletteMinBounce = static_cast<int>(renderer.getRouletteMinBounce());
+	float throughputCutoff = renderer.getThroughputCutoff();
+	IMGUI_INPUT(ImGui::Checkbox("Russian roulette", &russianRoulette));
+	IMGUI_INPUT(ImGui::SliderInt("Min bounces", &rouletteMinBounce, 0, 16));
+	IMGUI_INPUT(ImGui::SliderFloat("Throughput cutoff", &throughputCutoff, 0.0f, 0.1f, "%.5f", ImGuiSliderFlags_Logarithmic));
+	renderer.setPathTermination(russianRoulette, static_cast<unsigned int>(rouletteMinBounce), throughputCutoff);
+	ImGui::SameLine();
+	ImGui::TextDisabled("(?)");
+	if (ImGui::BeginItemTooltip()) {
+		ImGui::TextUnformatted("After the min bounces a path continues with the probability of its throughput (unbiased),\npaths with a throughput below the cutoff end right away (0 = never, drops their light).\nThe bounces per path are shown in the traversal statistics");
+		ImGui::EndTooltip();
+	}
+
+	ImGui::SeparatorText("Denoiser");
+	bool denoiser = renderer.isDenoiser();
+	DenoiserSettings denoiserSettings = renderer.getDenoiserSettings();
+	ImGui::Checkbox("A-trous denoiser", &denoiser);
+	ImGui::SliderInt("Iterations", &denoiserSettings.iterations, 1, 8);
+	ImGui::SliderFloat("Luminance sigma", &denoiserSettings.sigma_luminance, 0.5f, 32.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+	ImGui::SliderFloat("Normal sigma", &denoiserSettings.sigma_normal, 1.0f, 256.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+	ImGui::SliderFloat("Depth sigma", &denoiserSettings.sigma_depth, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+	ImGui::SliderFloat("Albedo sigma", &denoiserSettings.sigma_albedo, 0.01f, 1.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+	renderer.setDenoiser(denoiser, denoiserSettings);
+	ImGui::SameLine();
+	ImGui::TextDisabled("(?)");
+	if (ImGui::BeginItemTooltip()) {
+		ImGui::TextUnformatted("Blurs the lighting along the surfaces (guided by the normals, depths and albedos of the primary hits),\na usable image after 4-16 samples per pixel");
+		ImGui::EndTooltip();
+	}
+
+	ImGui::End();
+	if (disabled) { ImGui::EndDisabled(); }
+}
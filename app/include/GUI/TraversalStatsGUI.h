@@ -0,0 +1,56 @@
+#pragma once
+#include <imgui.h>
+#include <cfloat>
+
+#include "core/Renderer.h"
+
+/**
+* @brief Shows the frame totals of the traversal statistics and the histogram of the per pixel traversal cost
+* @param renderer - the renderer recording the statistics
+* */
+void genTraversalStatsGUI(Renderer& renderer)
+{
+	ImGui::Begin("Traversal Statistics");
+
+	bool enabled = renderer.isTraversalStats();
+	if (ImGui::Checkbox("Record statistics", &enabled)) {
+		renderer.setTraversalStats(enabled);
+	}
+	ImGui::SameLine();
+	ImGui::TextDisabled("(?)");
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::TextUnformatted("Every pixel records its work, a reduction pass sums it up.\nTracing is slower while recording.");
+		ImGui::EndTooltip();
+	}
+
+	if (!enabled) {
+		ImGui::End();
+		return;
+	}
+
+	const TraversalStats& stats = renderer.getTraversalStats();
+	double rays = stats.rays > 0 ? double(stats.rays) : 1.0;
+	ImGui::SeparatorText("Frame totals");
+	ImGui::Text("traced pixels: %u", stats.traced_pixels);
+	ImGui::Text("rays: %llu", stats.rays);
+	ImGui::Text("bounces: %llu (%.2f per ray)", stats.bounces, stats.bounces / rays);
+	// every traced pixel starts raysPerPixel paths, the path termination shortens them
+	double paths = double(stats.traced_pixels) * std::max(renderer.rtx_uniform_parameters.raysPerPixel, 1u);
+	ImGui::Text("bounces per path: %.2f", paths > 0.0 ? stats.bounces / paths : 0.0);
+	ImGui::Text("node visits: %llu (%.1f per ray)", stats.node_visits, stats.node_visits / rays);
+	ImGui::Text("triangle intersections: %llu (%.2f per ray)", stats.triangle_intersections, stats.triangle_intersections / rays);
+
+	ImGui::SeparatorText("Pixel cost histogram");
+	float histogram[traversal_stats_SSBO_struct::histogram_bins];
+	int lastBin = 0;
+	for (unsigned int bin = 0; bin < traversal_stats_SSBO_struct::histogram_bins; bin++) {
+		histogram[bin] = float(stats.cost_histogram[bin]);
+		if (stats.cost_histogram[bin] != 0) { lastBin = bin; }
+	}
+	ImGui::PlotHistogram("##costHistogram", histogram, lastBin + 1, 0, nullptr, 0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+	ImGui::TextDisabled("node visits + triangle intersections per pixel, bin b = [2^(b-1), 2^b)");
+
+	ImGui::End();
+}
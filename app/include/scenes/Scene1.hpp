@@ -1,5 +1,9 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#include "core/ObjParser/ObjParser.h"
 
 
 #ifndef RTX_MATERIAL
@@ -144,4 +148,40 @@ SceneData sponza_lights_scene() {
     sceneData.size = sceneData.numberOfObjects * sizeof(Sphere);
 
     return sceneData;
-}
\ No newline at end of file
+}
+
+
+/**
+* @brief The models of the scenes (each model is placed with its own transformation)
+* the paths are relative to APP_RESOURCES_PATH "models/"
+* */
+BVH::ModelInstance model(const std::string& fileName, const glm::mat4& transform = glm::mat4(1.0f)) {
+    BVH::ModelInstance instance;
+    instance.path = std::string(APP_RESOURCES_PATH "models/") + fileName;
+    instance.transform = transform;
+    return instance;
+}
+
+std::vector<BVH::ModelInstance> stanford_dragon_models() {
+    return { model("stanford_dragon_pbr.glb") };
+}
+
+std::vector<BVH::ModelInstance> stanford_bunny_models() {
+    return { model("stanford_bunny.obj") };
+}
+
+std::vector<BVH::ModelInstance> sponza_models() {
+    return { model("sponza.obj") };
+}
+
+std::vector<BVH::ModelInstance> suzanne_models() {
+    return { model("suzanne_high_poly_rotated.glb") };
+}
+
+// a dragon and a bunny next to each other
+std::vector<BVH::ModelInstance> dragon_and_bunny_models() {
+    return {
+        model("stanford_dragon_pbr.glb", glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, 0.0f))),
+        model("stanford_bunny.obj", glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)))
+    };
+}
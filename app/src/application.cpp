@@ -14,6 +14,7 @@
 // standard
 #include <iostream>
 #include <fstream> 
+#include <future>
 #include <string>
 #include <sstream> 
 #include <vector>
@@ -21,7 +22,10 @@
 
 // core
 #include "core/Renderer.h" 
+#include "core/SceneLoader.h"
+#include "core/ObjParser/BVHQuery.h"
 #include "core/gl_util/OpenGLdebugFuncs.h"
+#include "core/util/Profiler.h"
 #include "core/camera/CameraHandler.hpp"
 
 // app
@@ -31,12 +35,18 @@
 #include "GUI/InspectorGUI.h"
 #include "GUI/SkyBoxGUI.h"
 #include "GUI/BVHsettingsGUI.h"
+#include "GUI/LoadingGUI.h"
+#include "GUI/RendererSettingsGUI.h"
+#include "GUI/ProfilerGUI.h"
+#include "GUI/TraversalStatsGUI.h"
 
 #include "delta_lib/DeltaTime.h"
 #include "scenes/Scene1.hpp"
 
 const int SCREEN_WIDTH = 1920, SCREEN_HEIGHT = 1080;
 int main() {
+	Profiler::setThreadName("Main");
+
 	//WINDOW SETUP
 	GLFWwindow* window;
 	if (!glfwInit()){
@@ -79,16 +89,16 @@ int main() {
 		// set the active heuristic (SURFACE_AREA_HEURISTIC_BUCKETS, SURFACE_AREA_HEURISTIC, SPATIAL_MIDDLE_SPLIT, OBJECT_MEDIAN_SPLIT)
 		BVH::Heuristic active_heuristic = BVH::Heuristic::SURFACE_AREA_HEURISTIC_BUCKETS;
 
-		//BVH::BVH_data scene_BVH = BVH::construct(APP_RESOURCES_PATH "models/suzanne_high_poly_rotated.glb", active_heuristic);
-		BVH::BVH_data scene_BVH = BVH::construct(APP_RESOURCES_PATH "models/stanford_dragon_pbr.glb", active_heuristic);
-		//BVH::BVH_data scene_BVH = BVH::construct(APP_RESOURCES_PATH "models/sponza.obj", active_heuristic);
-		//BVH::BVH_data scene_BVH = BVH::construct(APP_RESOURCES_PATH "models/stanford_bunny.obj", active_heuristic);
-		std::cout << "BVH height: " << scene_BVH.BVH_tree_depth << std::endl;
+		// the mesh is loaded and its BVH built in the background, until then only the spheres are rendered
+		SceneLoader sceneLoader;
+		// the models of every scene are defined in scenes/Scene1.hpp
+		sceneLoader.Start(stanford_dragon_models(), active_heuristic);
+		unsigned int BVH_tree_depth = 0;
 		
 		//camera.posVec = glm::vec3(3.027f, 46.893f, -134.682f); // set the initial camera position for stanford dragon
 		//camera.posVec = glm::vec3(-116.479f, 84.908f, 86.822f);
 		camera.posVec = glm::vec3(1.0f, 0.0f, 0.0f);
-		Renderer renderer(sceneData, scene_BVH);
+		Renderer renderer(sceneData, BVH::BVH_data());
 		
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
@@ -138,6 +148,9 @@ int main() {
 		int displayed_layer = 1;
 		bool display_multiple = true;
 		int BVH_height = 30; // the height of the BVH tree (the size of the traversal stack in the shader)
+		bool run_query_benchmark = false;
+		std::string query_benchmark_summary;
+		std::future<BVH::QueryBenchmark> query_benchmark; // runs on its own thread, reads the mesh of the renderer
 
 		unsigned int viewport_mouseX;
 		unsigned int viewport_mouseY;
@@ -151,10 +164,24 @@ int main() {
 		unsigned int same_mouse_pos_count = 0;
 
 		while (!glfwWindowShouldClose(window)) {
+			PROFILE_SCOPE("Frame");
 			deltaTime.update();
 			totalFrames += 1;
+			renderer.getProfiler().BeginFrame();
 			was_ImGui_Input = false;
 
+			// hot-swap the mesh once the background loading is done
+			if (sceneLoader.IsReady()) {
+				if (query_benchmark.valid()) {
+					query_benchmark.wait(); // the mesh it reads is about to be replaced
+				}
+				BVH::BVH_data scene_BVH = sceneLoader.TakeResult();
+				BVH_tree_depth = scene_BVH.BVH_tree_depth;
+				std::cout << "BVH height: " << BVH_tree_depth << std::endl;
+				renderer.setMeshData(std::move(scene_BVH));
+				was_ImGui_Input = true; // restart the accumulation
+			}
+
 			GLCall(glClear(GL_COLOR_BUFFER_BIT));
 			GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
 
@@ -167,7 +194,34 @@ int main() {
 			genInspector(cameraHandler.CameraControllMode);
 			component_cameraGUI(camera, was_ImGui_Input, cameraHandler.CameraControllMode, shouldAccumulate, shouldPostProcess, raysPerPixel, bouncesPerRay);
 			genSkyboxGUI(SkyGroundColor, SkyColorHorizon, SkyColorZenith, show_skybox, was_ImGui_Input, cameraHandler.CameraControllMode);
-			BVH_settings_GUI(display_BVH, active_heuristic, scene_BVH.BVH_tree_depth, heatmap_color_limit, showPixelData, was_ImGui_Input, cameraHandler.CameraControllMode);
+			BVH_settings_GUI(display_BVH, active_heuristic, BVH_tree_depth, heatmap_color_limit, showPixelData, was_ImGui_Input, run_query_benchmark, query_benchmark_summary.c_str(), cameraHandler.CameraControllMode);
+			if (run_query_benchmark) {
+				run_query_benchmark = false;
+				if (!renderer.hasMesh()) {
+					query_benchmark_summary = "No mesh loaded yet";
+				}
+				else if (!query_benchmark.valid()) {
+					const BVH::BVH_data& mesh = renderer.getMeshData();
+					query_benchmark = std::async(std::launch::async, [&mesh]() { return BVH::benchmarkQueries(mesh, 1u << 15); });
+					query_benchmark_summary = "Running...";
+				}
+			}
+			if (query_benchmark.valid() && query_benchmark.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				BVH::QueryBenchmark benchmark = query_benchmark.get();
+				double rays = double(benchmark.rays);
+				char summary[512];
+				snprintf(summary, sizeof(summary),
+					"%u rays, %.1f%% occluded, %u mismatches\n"
+					"closest-hit: %.2f ms, %.1f nodes + %.1f triangles per ray\n"
+					"any-hit:     %.2f ms, %.1f nodes + %.1f triangles per ray\n"
+					"speedup: %.2fx",
+					benchmark.rays, 100.0 * benchmark.occluded_rays / rays, benchmark.mismatches,
+					benchmark.closest_hit_ms, benchmark.closest_hit_counters.node_visits / rays, benchmark.closest_hit_counters.triangle_tests / rays,
+					benchmark.any_hit_ms, benchmark.any_hit_counters.node_visits / rays, benchmark.any_hit_counters.triangle_tests / rays,
+					benchmark.closest_hit_ms / std::max(benchmark.any_hit_ms, 1e-6));
+				query_benchmark_summary = summary;
+			}
+			genRendererSettingsGUI(renderer, was_ImGui_Input, cameraHandler.CameraControllMode);
 
 
 
@@ -239,16 +293,11 @@ int main() {
 			
 			static bool wasGlobalInput; // input from the camera, ImGui or any other source (which should reset accumulation)
 			wasGlobalInput = (camera.wasCameraInput || was_ImGui_Input || !shouldAccumulate);
-			static unsigned int m_NumAccumulatedFrames;
-			if (wasGlobalInput) { m_NumAccumulatedFrames = 0; }
-			else { m_NumAccumulatedFrames++; }
 
 			viewport_mouseX = ImGui::GetMousePos().x - topLeftTextureCoords.x;
 			viewport_mouseY = ImGui::GetMousePos().y - topLeftTextureCoords.y;
 			inverted_viewport_mouseY = viewportSize.y - viewport_mouseY;
 			// render the scene
-			renderer.BeginComputeRtxStage();
-			renderer.rtx_uniform_parameters.numAccumulatedFrames = m_NumAccumulatedFrames;
 			renderer.rtx_uniform_parameters.raysPerPixel = raysPerPixel;
 			renderer.rtx_uniform_parameters.bouncesPerRay = bouncesPerRay;
 			renderer.rtx_uniform_parameters.FocalLength = camera.focalLength;
@@ -262,17 +311,14 @@ int main() {
 			renderer.rtx_uniform_parameters.display_BVH = display_BVH;
 			renderer.rtx_uniform_parameters.displayed_layer = displayed_layer;
 			renderer.rtx_uniform_parameters.display_multiple = display_multiple;
-			renderer.rtx_uniform_parameters.BVH_tree_depth = scene_BVH.BVH_tree_depth;
+			renderer.rtx_uniform_parameters.BVH_tree_depth = BVH_tree_depth;
 			renderer.rtx_uniform_parameters.show_skybox = show_skybox;
 			renderer.rtx_uniform_parameters.heatmap_color_limit = heatmap_color_limit;
 			renderer.rtx_uniform_parameters.pixelGlobalInvocationID = glm::vec3(viewport_mouseX, inverted_viewport_mouseY, 1.0f); // invocations start from bottom left
+			renderer.setShowPixelData(showPixelData);
+			renderer.setPixelDataReadback(ImGui::IsWindowHovered() && showPixelData && !cameraHandler.CameraControllMode);
 
-
-			ComputeTexture* outputTexture = renderer.RenderComputeRtxStage();
-			
-			renderer.BeginComputePostProcStage();
-			renderer.postProcessing_uniform_parameters.numAccumulatedFrames = m_NumAccumulatedFrames;
-			ComputeTexture* postProcOutput = renderer.RenderComputePostProcStage();
+			ComputeTexture* postProcOutput = renderer.RenderFrame();
 			
 			ImDrawList* drawList = ImGui::GetWindowDrawList();
 			drawList->AddImage((ImTextureID)postProcOutput->ID(), topLeftTextureCoords, bottomLeftTextureCoords, {0, 1}, {1, 0});
@@ -316,12 +362,24 @@ int main() {
 			ImGui::PopStyleVar();
 			ImGui::End();
 			
-			genPerformanceCounter();
+			genPerformanceCounter(renderer.getRaysPerFrame(), renderer.getRaysPerSecond());
+			genProfilerGUI(renderer.getProfiler());
+			genTraversalStatsGUI(renderer);
+			genLoadingGUI(sceneLoader);
 			camera.ResetFlags();
 			
-			ImGui::Render();
-			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-			glfwSwapBuffers(window);
+			{
+				PROFILE_SCOPE("ImGui::Render");
+				ImGui::Render();
+				renderer.getProfiler().BeginZone("ImGui");
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+				renderer.getProfiler().EndZone();
+				renderer.getProfiler().EndFrame();
+			}
+			{
+				PROFILE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
 			glfwPollEvents();
 		}
 	}
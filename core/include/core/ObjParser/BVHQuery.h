@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+#include "core/ObjParser/ObjParser.h"
+
+/**
+ * Ray queries against a built BVH on the CPU (the same traversal and back-face culled triangle test as the shaders)
+ * - closestHit finds the nearest triangle, like BVH_traverse in include/RayTracingCommon.glsl
+ * - occluded only answers whether anything lies on the ray segment and stops at the first hit,
+ *   like BVH_occluded (shadow and visibility rays)
+ * Only the triangles of the mesh are tested, the analytic spheres are not part of the BVH.
+ */
+namespace BVH {
+
+    // work done by the queries, the same quantities as the traversal statistics of the renderer
+    struct QueryCounters {
+        unsigned long long node_visits = 0;             ///< interior nodes whose AABB was hit
+        unsigned long long triangle_tests = 0;          ///< ray-triangle tests
+    };
+
+    /**
+     * @brief Finds the closest triangle hit by the ray (dir doesn't have to be normalized, distances are in units of dir).
+     * @param hit_dst distance of the hit (return value, only written on a hit)
+     * @param hit_triangle index of the hit triangle in bvh.TRIANGLES (return value, only written on a hit)
+     * @return true if a triangle closer than max_dst was hit
+     */
+    bool closestHit(const BVH_data& bvh, const glm::vec3& origin, const glm::vec3& dir, float max_dst,
+        float& hit_dst, int& hit_triangle, QueryCounters* counters = nullptr);
+
+    /**
+     * @brief Returns whether any triangle lies on the ray closer than max_dst.
+     * The nodes behind max_dst are skipped and the traversal returns on the first hit found.
+     */
+    bool occluded(const BVH_data& bvh, const glm::vec3& origin, const glm::vec3& dir, float max_dst, QueryCounters* counters = nullptr);
+
+    /**
+     * @struct QueryBenchmark
+     * @brief Results of benchmarkQueries, the same visibility rays answered by both queries.
+     */
+    struct QueryBenchmark {
+        unsigned int rays = 0;
+        unsigned int occluded_rays = 0;                 ///< rays blocked before reaching their end point
+        unsigned int mismatches = 0;                    ///< rays the two queries disagreed on (should be 0)
+        double closest_hit_ms = 0.0;
+        double any_hit_ms = 0.0;
+        QueryCounters closest_hit_counters;
+        QueryCounters any_hit_counters;
+    };
+
+    /**
+     * @brief Times closestHit against occluded on ray_count visibility rays between random points of random triangles.
+     * A closest hit query answers the visibility by comparing the hit distance with the distance of the end point.
+     * Runs single threaded on the calling thread, the rays are generated before the timing starts.
+     */
+    QueryBenchmark benchmarkQueries(const BVH_data& bvh, unsigned int ray_count, uint32_t seed = 1);
+}
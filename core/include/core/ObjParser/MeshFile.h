@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/ObjParser/ObjParser.h"
+#include "core/util/MappedFile.h"
+
+/**
+ * The native mesh container (.rtmesh)
+ *
+ * Layout of the file:
+ *  - Header (magic, version, section table)
+ *  - sections, each starting at a multiple of section_alignment
+ *
+ * The TRIANGLES section stores the triangles exactly as the MESH_buffer SSBO expects them
+ * (std140 Triangle records with the vertices, normals, centroid and material interleaved),
+ * so loading is a single bulk copy out of the mapping instead of a parse.
+ * The records are still copied once: the BVH build sorts the triangles into the order of its leaves
+ * (and the instances of a scene are transformed), the MESH_buffer is uploaded from the built BVH, never from the file.
+ *
+ * All values are stored in the native (little endian) byte order.
+ */
+namespace MeshFile {
+
+    const char file_extension[] = ".rtmesh";
+    const char magic[8] = { 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+    const uint32_t version = 2; // 2 = the unused MATERIALS section was dropped
+
+    // 256 bytes is the largest GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT in the wild
+    const uint64_t section_alignment = 256;
+
+    enum class SectionType : uint32_t {
+        TRIANGLES = 0,
+        COUNT
+    };
+
+    struct Section {
+        uint32_t type;          ///< SectionType
+        uint32_t element_size;  ///< sizeof one record, used to reject files written with a different struct layout
+        uint64_t offset;        ///< offset of the first record from the beginning of the file
+        uint64_t count;         ///< number of records
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t section_count;
+        uint64_t file_size;
+        Section sections[static_cast<size_t>(SectionType::COUNT)];
+    };
+
+    /**
+     * @class View
+     * @brief A validated, memory mapped .rtmesh file.
+     *
+     * The pointers returned by the getters point directly into the mapping
+     * and stay valid for the lifetime of the View.
+     */
+    class View {
+    public:
+        View(const std::string& path);
+
+        inline bool isValid() const { return m_Triangles != nullptr; }
+
+        inline const Triangle* triangles() const { return m_Triangles; }
+        inline size_t triangleCount() const { return m_TriangleCount; }
+
+    private:
+        const void* getSection(const Header& header, SectionType type, uint32_t element_size, size_t& count) const;
+
+        std::unique_ptr<MappedFile> m_File;
+
+        const Triangle* m_Triangles = nullptr;
+        size_t m_TriangleCount = 0;
+    };
+
+    // returns true if the path has the .rtmesh extension
+    bool isMeshFile(const std::string& path);
+
+    /**
+     * @brief Writes a triangle mesh into a .rtmesh file.
+     * @return false if the file could not be written
+     */
+    bool write(const std::string& path, const std::vector<Triangle>& triangles);
+
+    /**
+     * @brief Loads a .rtmesh file into a mesh (a single bulk copy out of the mapping).
+     * Has the same contract as loadMesh.
+     */
+    void load(const std::string& path, std::vector<Triangle>& mesh, unsigned int& numTriangles);
+
+    /**
+     * @brief Converts any file assimp can import into a .rtmesh file.
+     * @return false if the source could not be imported or the destination could not be written
+     */
+    bool convert(const std::string& source_path, const std::string& destination_path);
+
+    /**
+     * @brief Returns the path of the .rtmesh file cached next to the source model.
+     *
+     * The cache is (re)built when it is missing, older than the source model or written by another version,
+     * so the slow import only happens the first time a model is opened.
+     * If the conversion fails the source path is returned.
+     */
+    std::string getCached(const std::string& source_path);
+}
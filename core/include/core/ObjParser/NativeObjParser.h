@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "core/ObjParser/ObjParser.h"
+
+/**
+ * Dedicated multi-threaded Wavefront OBJ loader which bypasses assimp.
+ *
+ * The file is memory mapped and split into line aligned chunks which are parsed in parallel:
+ *  1. every chunk counts its "v" and "vn" lines, a prefix sum gives each chunk its first global index
+ *  2. every chunk parses its positions and normals straight into the shared arrays and resolves its faces
+ *     (including negative/relative indices) into triangles
+ *  3. the triangles of all chunks are written into the mesh in parallel
+ *
+ * Polygons are fan-triangulated, faces without normals get the flat face normal.
+ * Texture coordinates, groups and materials are skipped (the renderer doesn't use them).
+ */
+namespace NativeObj {
+
+    // returns true if the path has the .obj extension (case insensitive)
+    bool isObjFile(const std::string& path);
+
+    /**
+     * @brief Loads an OBJ file into a mesh. Has the same contract as loadMesh.
+     * @return false if the file could not be mapped or contained no triangles (the caller can fall back to assimp)
+     */
+    bool load(const std::string& path, std::vector<Triangle>& mesh, unsigned int& numTriangles);
+}
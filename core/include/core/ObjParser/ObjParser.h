@@ -6,6 +6,7 @@
 #include <string>
 #include <algorithm>
 #include <queue>
+#include <functional>
 
 // third-party
 #define GLM_ENABLE_EXPERIMENTAL
@@ -79,12 +80,17 @@ struct Triangle
  *
  * This function reads an OBJ file and extracts the vertex, vertex normal, and face information to construct a mesh of triangles.
  * The mesh and the number of triangles are returned via reference parameters.
+ * Native .rtmesh files (see MeshFile.h) are memory mapped and copied in bulk instead of being imported.
+ * OBJ files go through the multi-threaded NativeObj parser, everything else (and OBJ files it can't read) through assimp.
  *
  * @param filePath The path to the OBJ file.
  * @param mesh A reference to a vector of Triangles that will be filled with the triangles from the OBJ file.
  * @param numTriangles A reference to an unsigned int that will be set to the number of triangles in the mesh.
  */
 void loadMesh(std::string filePath, std::vector<Triangle>& mesh, unsigned int& numTriangles);
+
+/** @brief The material assigned to every loaded triangle (the importers don't read material files yet). */
+RaytracingMaterial getDefaultMaterial();
 #endif
 
 #ifndef BVH_IMPLEMENTATION
@@ -154,11 +160,11 @@ namespace BVH {
         std::vector<BVH::Node> BVH;
         std::vector<Triangle> TRIANGLES;
         
-        unsigned int BVH_tree_depth;
+        unsigned int BVH_tree_depth = 0;
         std::vector<glm::vec3> heatmapLayers;
 
-        unsigned int BVH_size;
-        unsigned int TRIANGLES_size;
+        unsigned int BVH_size = 0;
+        unsigned int TRIANGLES_size = 0;
     };
 
     // Helper functions for calculating the minimum and maximum vectors of an AABB
@@ -228,16 +234,79 @@ namespace BVH {
 
     BVH::Partition_output surface_area_heuristic(const BVH::Node parent_node, std::vector<unsigned int>& triangle_indices, const std::vector<Triangle>& triangles, const bool& split_buckets);
 
+    // The stages of BVH::construct reported through the progress callback
+    enum class BuildStage {
+        LOADING_MESH,
+        BUILDING_BVH,
+        DONE
+    };
+
+    /**
+     * @brief Called by BVH::construct as the construction advances.
+     * stage_progress is the progress of the current stage in the range [0, 1].
+     * The callback is invoked on the thread that runs the construction.
+     */
+    using ProgressCallback = std::function<void(BuildStage stage, float stage_progress)>;
+
     /**
      * @brief Constructs a Bounding Volume Hierarchy (BVH) from a 3D mesh.
      *
      * This function reads a 3D mesh from a file, constructs a BVH from the mesh, and returns the BVH data.
+     * If the mesh can't be loaded an empty BVH_data (BVH_size == 0) is returned.
      *
      * @param path The path to the file containing the 3D mesh.
      * @param heuristic The heuristic to use for partitioning the BVH nodes.
+     * @param progress_callback Optional, reports the progress of the construction (see ProgressCallback).
      * @return A BVH_data structure containing the data of the constructed BVH.
      */
-    BVH::BVH_data construct(std::string path, const Heuristic heuristic);
+    BVH::BVH_data construct(std::string path, const Heuristic heuristic, const ProgressCallback& progress_callback = nullptr);
+
+    /**
+     * @brief Constructs a BVH over an already loaded set of triangles.
+     *
+     * @param triangles The triangles of the mesh (moved into the returned BVH_data).
+     * @param heuristic The heuristic to use for partitioning the BVH nodes.
+     * @param progress_callback Optional, only the BUILDING_BVH and DONE stages are reported.
+     * @return A BVH_data structure containing the data of the constructed BVH (empty if there are no triangles).
+     */
+    BVH::BVH_data build(std::vector<Triangle> triangles, const Heuristic heuristic, const ProgressCallback& progress_callback = nullptr);
+
+    /**
+     * @struct ModelInstance
+     * @brief A model file placed in the scene with its own transformation.
+     */
+    struct ModelInstance {
+        std::string path;
+        glm::mat4 transform = glm::mat4(1.0f);
+    };
+
+    /**
+     * @brief Constructs a single scene-level BVH from many model files.
+     *
+     * Every model is loaded, transformed and gets its own BVH concurrently (one task per model),
+     * the per-model BVHs are then merged under a small top-level tree (see BVH::merge).
+     *
+     * @param models The models of the scene.
+     * @param heuristic The heuristic to use for partitioning the BVH nodes.
+     * @param progress_callback Optional, reports the combined progress of all the models (can be called from several threads, calls are serialized).
+     * @return A BVH_data structure containing the data of the whole scene.
+     */
+    BVH::BVH_data constructScene(const std::vector<ModelInstance>& models, const Heuristic heuristic, const ProgressCallback& progress_callback = nullptr);
+
+    /**
+     * @brief Merges independent BVHs into one.
+     *
+     * The triangles and nodes of every part are appended one after another (with their indices offset accordingly)
+     * and a top-level tree, built by median splits over the part root bounding boxes, is placed in front of them,
+     * so the root of the merged BVH stays at index 0.
+     *
+     * @param parts The BVHs to merge (their data is moved out).
+     * @return The merged BVH.
+     */
+    BVH::BVH_data merge(std::vector<BVH::BVH_data>& parts);
+
+    // Applies a model transformation to the vertices, normals and centroids of the triangles
+    void transformTriangles(std::vector<Triangle>& triangles, const glm::mat4& transform);
 
     unsigned int getBVHTreeDepth(const std::vector<Node>& BVH, BVH::Node current_node, unsigned int height);
 }
@@ -1,8 +1,17 @@
 #pragma once
 #include <GL/glew.h>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
 
 #include "core/gl_util/ComputeShader.h"
 #include "core/gl_util/ComputeTexture.h"
+#include "core/gl_util/GPUResourceManager.h"
+#include "core/gl_util/UniformRingBuffer.h"
+#include "core/gl_util/AsyncReadbackBuffer.h"
+#include "core/gl_util/GPUTimer.h"
+#include "core/gl_util/GPUProfiler.h"
+#include "core/gl_util/RenderGraph.h"
 
 #include "imgui.h"
 
@@ -29,31 +38,62 @@ struct PixelData {
 /**
 * @brief The rtx_parameters_uniform_struct struct
 * This struct is used to pass the uniform
-* data to the compute shader for the ray tracing stage (in std140 layout)
+* data to the compute shader for the ray tracing stage.
+* Its memory layout matches the std140 block so it is copied to the GPU as a whole,
+* vec3s are padded to 16 bytes and GLSL bools are stored as 4 byte uints.
 * */
 struct rtx_parameters_uniform_struct {
-	unsigned int numAccumulatedFrames;      // offset 0  // alignment 4 // total 4 bytes
+	unsigned int unused_0;                  // offset 0  // alignment 4 // total 4 bytes (the pixels count their frames in the rtx texture)
 	unsigned int raysPerPixel;              // offset 4  // alignment 4 // total 8 bytes
 	unsigned int bouncesPerRay;             // offset 8  // alignment 4 // total 12 bytes
 	float FocalLength;						// offset 12 // alignment 4 // total 16 bytes
 
-	glm::vec3 skyboxGroundColor;			// offset 16 // alignment 16 // total 32 bytes
-	glm::vec3 skyboxHorizonColor;			// offset 32 // alignment 16 // total 48 bytes
-	glm::vec3 skyboxZenithColor;			// offset 48 // alignment 16 // total 64 bytes                            
-	glm::vec3 CameraPos;					// offset 64 // alignment 16 // total 80 bytes
+	glm::vec3 skyboxGroundColor;			// offset 16 // alignment 16 // total 28 bytes
+	float padding_0;						// offset 28 // alignment 4 // total 32 bytes
+	glm::vec3 skyboxHorizonColor;			// offset 32 // alignment 16 // total 44 bytes
+	float padding_1;						// offset 44 // alignment 4 // total 48 bytes
+	glm::vec3 skyboxZenithColor;			// offset 48 // alignment 16 // total 60 bytes
+	float padding_2;						// offset 60 // alignment 4 // total 64 bytes
+	glm::vec3 CameraPos;					// offset 64 // alignment 16 // total 76 bytes
+	float padding_3;						// offset 76 // alignment 4 // total 80 bytes
 
-	glm::vec3 pixelGlobalInvocationID;		// offset 80 // alignment 16 // total 96 bytes
+	glm::vec3 pixelGlobalInvocationID;		// offset 80 // alignment 16 // total 92 bytes
+	float padding_4;						// offset 92 // alignment 4 // total 96 bytes
 
 	glm::mat4 ModelMatrix;					// offset 96 // alignment 16 // total 160 bytes
 
-	bool WasInput;							// offset 160 // alignment 4 // total 164 bytes
-	bool display_BVH = display_BVH;					// offset 164 // alignment 4 // total 168 bytes
-	bool display_multiple = display_multiple;		// offset 168 // alignment 4 // total 172 bytes
-	unsigned int displayed_layer = displayed_layer; // offset 172 // alignment 4 // total 176 bytes
-	unsigned int BVH_tree_depth = BVH_tree_depth;	// offset 176 // alignment 4 // total 180 bytes
-	bool show_skybox = show_skybox;					// offset 180 // alignment 4 // total 184 bytes
-	int heatmap_color_limit = heatmap_color_limit;	// offset 184 // alignment 4 // total 188 bytes
+	unsigned int WasInput;					// offset 160 // alignment 4 // total 164 bytes (the renderer keeps it set until the whole image was traced once)
+	unsigned int display_BVH;				// offset 164 // alignment 4 // total 168 bytes
+	unsigned int display_multiple;			// offset 168 // alignment 4 // total 172 bytes
+	unsigned int displayed_layer;			// offset 172 // alignment 4 // total 176 bytes
+	unsigned int BVH_tree_depth;			// offset 176 // alignment 4 // total 180 bytes
+	unsigned int show_skybox;				// offset 180 // alignment 4 // total 184 bytes
+	int heatmap_color_limit;				// offset 184 // alignment 4 // total 188 bytes
+	unsigned int reprojectHistory;			// offset 188 // alignment 4 // total 192 bytes (set by the renderer, > 0 = reproject the history, capped at this many frames)
+
+	glm::ivec2 renderSize;					// offset 192 // alignment 8 // total 200 bytes (set by the renderer)
+	unsigned int frameIndex;				// offset 200 // alignment 4 // total 204 bytes (set by the renderer)
+	unsigned int padding_5;					// offset 204 // alignment 4 // total 208 bytes
+
+	glm::vec3 PrevCameraPos;				// offset 208 // alignment 16 // total 220 bytes (set by the renderer, the camera of the previous frame)
+	float PrevFocalLength;					// offset 220 // alignment 4 // total 224 bytes
+	glm::mat4 PrevModelMatrix;				// offset 224 // alignment 16 // total 288 bytes
+
+	unsigned int russianRoulette;			// offset 288 // alignment 4 // total 292 bytes (set by the renderer, the path termination settings)
+	unsigned int rouletteMinBounce;			// offset 292 // alignment 4 // total 296 bytes
+	float throughputCutoff;					// offset 296 // alignment 4 // total 300 bytes
+	float padding_6;						// offset 300 // alignment 4 // total 304 bytes
 };
+static_assert(offsetof(rtx_parameters_uniform_struct, skyboxHorizonColor) == 32, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, pixelGlobalInvocationID) == 80, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, ModelMatrix) == 96, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, WasInput) == 160, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, heatmap_color_limit) == 184, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, renderSize) == 192, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, PrevCameraPos) == 208, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, PrevModelMatrix) == 224, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(offsetof(rtx_parameters_uniform_struct, russianRoulette) == 288, "rtx_parameters_uniform_struct doesn't match the std140 layout");
+static_assert(sizeof(rtx_parameters_uniform_struct) == 304, "rtx_parameters_uniform_struct doesn't match the std140 layout");
 
 /**
 * @brief The postProcessing_parameters_uniform_struct struct
@@ -61,7 +101,64 @@ struct rtx_parameters_uniform_struct {
 * data to the compute shader for the post processing stage (in std140 layout)
 * */
 struct postProcessing_parameters_uniform_struct {
-	unsigned int numAccumulatedFrames;
+	unsigned int unused_0;					// offset 0 // alignment 4 // total 4 bytes
+	unsigned int padding_0;					// offset 4 // alignment 4 // total 8 bytes
+	glm::ivec2 renderSize;					// offset 8 // alignment 8 // total 16 bytes (set by the renderer)
+};
+static_assert(offsetof(postProcessing_parameters_uniform_struct, renderSize) == 8, "postProcessing_parameters_uniform_struct doesn't match the std140 layout");
+
+/**
+* @brief The traversal_stats_SSBO_struct struct
+* The frame totals written by the stats reduction pass (binding point 12, std430),
+* must match include/TraversalStats.glsl.
+* */
+struct traversal_stats_SSBO_struct {
+	static const unsigned int histogram_bins = 32;
+
+	unsigned int totals[8];							// offset 0  // 64 bit (low, high) pairs: rays, bounces, node visits, triangle intersections
+	unsigned int traced_pixels;						// offset 32
+	unsigned int padding[3];						// offset 36
+	unsigned int cost_histogram[histogram_bins];	// offset 48
+};
+static_assert(offsetof(traversal_stats_SSBO_struct, cost_histogram) == 48, "traversal_stats_SSBO_struct doesn't match the std430 layout");
+
+/**
+* @brief The TraversalStats struct
+* Frame totals of the traversal statistics (Renderer::setTraversalStats), a few frames behind.
+* node visits are the interior BVH nodes whose AABB was hit, triangle intersections the ray-triangle hits.
+* */
+struct TraversalStats {
+	unsigned long long rays = 0;
+	unsigned long long bounces = 0;
+	unsigned long long node_visits = 0;
+	unsigned long long triangle_intersections = 0;
+	unsigned int traced_pixels = 0;
+	// traced pixels per log2 bin of the pixel cost (node visits + triangle intersections), bin b = [2^(b-1), 2^b), bin 0 = no cost
+	unsigned int cost_histogram[traversal_stats_SSBO_struct::histogram_bins] = {};
+};
+
+/**
+* @brief The DenoiserSettings struct
+* Parameters of the edge-avoiding a-trous filter of the post processing stage (denoise/Atrous.comp)
+* */
+struct DenoiserSettings {
+	int iterations = 4;				// the step of the 5x5 kernel doubles every iteration (4 iterations = 61x61 pixels)
+	float sigma_luminance = 4.0f;	// luminance differences in standard deviations of the pixel
+	float sigma_normal = 128.0f;	// exponent of the cosine between the normals
+	float sigma_depth = 0.05f;		// depth differences relative to the depth of the pixel (per step)
+	float sigma_albedo = 0.1f;		// distance of the albedo colors
+};
+
+/**
+* @brief The TracingMode enum
+* MEGAKERNEL - one dispatch, every thread traces all the paths of its pixel (ComputeRayTracing.comp)
+* WAVEFRONT  - generate / extend / shade / accumulate passes connected by ray queues (shaders/wavefront)
+* PERSISTENT_THREADS - the megakernel with a fixed number of work groups fetching pixel batches from a global counter (ComputeRayTracingPersistent.comp)
+* */
+enum class TracingMode {
+	MEGAKERNEL,
+	WAVEFRONT,
+	PERSISTENT_THREADS
 };
 
 /**
@@ -79,50 +176,326 @@ private:
 	void initComputePostProcStage();
 
 	// unifom buffer object setup and functions
-	unsigned int rtx_parameters_UBO_ID, sphereBuffer_UBO_ID, postProcessing_parameters_UBO_ID, tris_SSBO_ID, BVH_SSBO_ID, pixelData_SSBO_ID;
+	unsigned int pixelData_SSBO_ID;
+
+	// per frame uniforms, written into persistently mapped rings (binding points 0 and 2)
+	UniformRingBuffer* rtx_parameters_UBO_ring;
+	UniformRingBuffer* postProcessing_parameters_UBO_ring;
 
 	void configure_rtx_parameters_UBO_block();
 	void update_rtx_parameters_UBO_block();
 
-	void configure_sphereBuffer_UBO_block();
-	void update_sphereBuffer_UBO_block();
-
 	void configure_postProcessing_parameters_UBO_block();
 	void update_postProcessing_parameters_UBO_block();
 
-	void configure_TrisMesh_SSBO_block();
-	void update_TrisMesh_SSBO_block();
-
-	void configure_BVH_SSBO_block();
-	void update_BVH_SSBO_block();
+	// scene buffers (spheres, mesh, BVH), only the modified ranges are uploaded at the start of the rtx stage
+	GPUResourceManager m_Resources;
+	void set_scene_resource_sources();
 
 	void configure_PixelData_SSBO_block();
 	void read_PixelData_SSBO_block();
 
+	AsyncReadbackBuffer* pixelData_readback;
+	bool m_ShowPixelData;		// the shader variants count the intersections for the pixel-data tooltip
+	bool m_PixelDataReadback;
+
+	// rays traced per frame (binding point 6), read back a few frames later
+	unsigned int rayCounter_SSBO_ID;
+	AsyncReadbackBuffer* rayCounter_readback;
+	unsigned int m_RaysPerFrame;
+
+	void configure_RayCounter_SSBO_block();
+	void read_RayCounter_SSBO_block();
+
+	TracingMode m_TracingMode;
+
+	// wavefront path tracing (binding points 7 - path states, 8 - ray queues, 9 - queue counters / dispatch arguments)
+	unsigned int pathStates_SSBO_ID, rayQueues_SSBO_ID, queueCounters_SSBO_ID;
+	size_t m_WavefrontPathCount; // the path buffers are allocated for this many pixels
+
+	void configure_Wavefront_SSBO_blocks();
+	void renderWavefront();
+
+	// persistent threads (binding point 10 - the next pixel to be taken)
+	unsigned int workCounter_SSBO_ID;
+	unsigned int m_PersistentWorkGroups;
+	bool m_SubgroupOps;		// the batches are fetched per subgroup (GL_KHR_shader_subgroup), otherwise per work group
+
+	void configure_WorkCounter_SSBO_block();
+	bool query_subgroup_ops() const;
+
+	// time budgeted tiles (megakernel only), every frame traces as many tiles as fit in the GPU time budget
+	const unsigned int m_TileSize = 64;
+	bool m_TiledRendering;
+	float m_FrameBudgetMs;
+	unsigned int m_NextTile;			// tiles are traced in scanline order, wrapping around
+	unsigned int m_TilesPerFrame;		// traced during the last frame
+	bool m_ResetPass;					// set until every tile was traced once since the last accumulation reset
+	unsigned int m_ResetPassFirstTile;	// the tile traced first after the reset
+	double m_MsPerPixel;				// GPU cost estimate from the timer queries (smoothed), < 0 until measured
+	GPUTimer* tileTimer;
+
+	void renderTiles();
+
+	// adaptive sampling (megakernel only), only the pixels with an error estimate above the threshold are traced
+	// binding point 11 - the active pixel list and its indirect dispatch arguments
+	bool m_AdaptiveSampling;
+	float m_ErrorThreshold;
+	unsigned int m_MinAccumulatedFrames;
+	unsigned int activePixels_SSBO_ID;
+	AsyncReadbackBuffer* activePixelCount_readback;
+	unsigned int m_ActivePixelCount;
+
+	void configure_ActivePixels_SSBO_block();
+	void renderAdaptive();
+
+	// dynamic resolution, while the camera moves only the top left part of the textures (m_RenderSize) is traced
+	// and the post processing stage upscales it
+	bool m_DynamicResolution;
+	float m_TargetFrameMs;
+	float m_ResolutionScale;
+	glm::ivec2 m_RenderSize;
+	double m_FrameMsPerPixel;		// GPU time of the rtx stage per traced pixel (smoothed), < 0 until measured
+	GPUTimer* frameTimer;
+
+	void update_render_size(bool is_moving, bool can_measure);
+
+	// specialization of the ray tracing shaders (exact scene loop bounds, heatmap, debug counters)
+	// the defines are shared by every ray tracing shader, a change switches all of them to the matching variant
+	ShaderDefines m_RtxShaderDefines;
+
+	ShaderDefines get_rtx_shader_defines() const;
+	void update_rtx_shader_variants();
+
+	// GPU time of the passes (uploads, rtx, stats, readback, post processing), the application marks the frame boundaries
+	GPUProfiler m_Profiler;
+
+	// the passes of a frame are added to the graph every frame, it orders them and emits the memory barriers between them
+	RenderGraph m_RenderGraph;
+
+	// traversal statistics, image binding point 3 - the work of every pixel, binding point 12 - frame totals and histogram
+	// the stats image is a transient texture of the render graph (only lives from the rtx pass to the stats reduction)
+	bool m_TraversalStats;
+	unsigned int traversalStats_SSBO_ID;
+	AsyncReadbackBuffer* traversalStats_readback;
+	TraversalStats m_LastTraversalStats;
+	ComputeShader* statsReduceShader;
+
+	void configure_TraversalStats_SSBO_block();
+	void reduce_traversal_stats();
+	void read_TraversalStats_SSBO_block();
+
+	// denoiser, the ray tracing shaders write the primary hit of every pixel into the feature images (image binding points 4 and 5),
+	// the a-trous iterations ping-pong between transient textures of the render graph (image binding points 6 and 7)
+	bool m_Denoiser;
+	DenoiserSettings m_DenoiserSettings;
+	ComputeTexture* featureTexture;
+	ComputeTexture* albedoTexture;
+	ComputeShader* denoiseShader;
+
+	bool is_denoising() const;
+	void update_denoiser_features();
+	void denoise_iteration(int iteration);
+
+	// temporal reprojection (full frame modes only, the tiles and the adaptive sampling still restart on a camera move)
+	// image binding points 6 - the accumulated image and 7 - the depths of the previous frame, 1 - the depths of the primary hits
+	// (the units of the denoiser and the post processing, only 8 are guaranteed, the render graph binds them per pass)
+	bool m_TemporalReprojection;
+	unsigned int m_MaxHistoryFrames;
+	ComputeTexture* historyTexture;
+	ComputeTexture* depthTexture;
+	ComputeTexture* historyDepthTexture;
+	unsigned int m_FrameIndex;
+	bool m_HasPreviousCamera;		// the previous camera and depths belong to the current render size
+	glm::ivec2 m_PreviousRenderSize;
+
+	bool is_reprojecting_enabled() const;
+	void update_reprojection_textures();
+
+	// next event estimation, binding point 13 - the light list (the indices of the emissive spheres, then of the emissive triangles)
+	// rebuilt on the CPU when the scene sources are (re)set, uploaded by the uploads pass
+	bool m_NextEventEstimation;
+	unsigned int lights_SSBO_ID;
+	std::vector<unsigned int> m_LightList;	// header (light count, sphere light count, 2 x padding) followed by the indices
+	bool m_LightsDirty;
+	bool m_LightsUploadPending;
+
+	bool is_sampling_lights() const;
+
+	// path termination, paths stop early once they can't add much more light (unbiased Russian roulette + a throughput cutoff)
+	bool m_RussianRoulette;
+	unsigned int m_RouletteMinBounce;
+	float m_ThroughputCutoff;
+	void configure_Lights_SSBO_block();
+	void update_light_list();
+	void upload_Lights_SSBO_block();
+
+	// the body of the rtx pass, traces with the current mode
+	void renderRtx(bool adaptive, bool tiled, bool reproject, RenderGraph::Handle stats_texture);
+
 public:
 	Renderer(SceneData& scene, BVH::BVH_data BVH_of_mesh);
 	~Renderer();
 
 	void setViewportSize(glm::vec2 viewportSize);
 
-	void BeginComputeRtxStage();
-	ComputeTexture* RenderComputeRtxStage();
-	rtx_parameters_uniform_struct rtx_uniform_parameters;
+	/**
+	* @brief Replaces the mesh and its BVH (reallocates and uploads the mesh SSBOs)
+	* The renderer can be created with an empty BVH_data, only the analytic spheres are rendered until the mesh is set.
+	* */
+	void setMeshData(BVH::BVH_data BVH_of_mesh);
+	inline bool hasMesh() const { return BVH_of_mesh.BVH_size > 0; }
+	// the CPU copy of the mesh and its BVH (for the CPU side ray queries, see core/ObjParser/BVHQuery.h)
+	inline const BVH::BVH_data& getMeshData() const { return BVH_of_mesh; }
+
+	inline size_t getLastUploadedBytes() const { return m_Resources.GetLastUploadedBytes(); }
+
+	inline void setTracingMode(TracingMode mode) { m_TracingMode = mode; }
+	inline TracingMode getTracingMode() const { return m_TracingMode; }
+
+	// number of work groups (64 threads each) launched in the PERSISTENT_THREADS mode, should be just enough to fill the GPU
+	inline void setPersistentWorkGroups(unsigned int work_groups) { m_PersistentWorkGroups = std::max(work_groups, 1u); }
+	inline unsigned int getPersistentWorkGroups() const { return m_PersistentWorkGroups; }
+	// whether the persistent threads fetch their pixels per subgroup (false = per work group, no GL_KHR_shader_subgroup support)
+	inline bool hasSubgroupOps() const { return m_SubgroupOps; }
 
-	PixelData pixelData; // should be read after rendering the compute rtx stage
+	// rays (closest hit queries) traced during a recent frame, lags a few frames behind
+	inline unsigned int getRaysPerFrame() const { return m_RaysPerFrame; }
 
-	void BeginComputePostProcStage();
-	ComputeTexture* RenderComputePostProcStage();
-	postProcessing_parameters_uniform_struct postProcessing_uniform_parameters;
+	// the stages are profiled while the application is between m_Profiler.BeginFrame() and EndFrame()
+	inline GPUProfiler& getProfiler() { return m_Profiler; }
+
+	// rays per second of the rtx stage alone (its GPU time from the profiler), 0 until measured
+	double getRaysPerSecond() const;
+
+	/**
+	* @brief Records the work of every pixel (rays, bounces, node visits, triangle intersections) into a stats image
+	* A reduction pass sums it up into the frame totals and a histogram of the per pixel traversal cost.
+	* The ray tracing shaders switch to a variant with the counters, so tracing is slower while enabled.
+	* */
+	inline void setTraversalStats(bool enabled) { m_TraversalStats = enabled; }
+	inline bool isTraversalStats() const { return m_TraversalStats; }
+	inline const TraversalStats& getTraversalStats() const { return m_LastTraversalStats; }
+
+	/**
+	* @brief Filters the accumulated image with an edge-avoiding a-trous wavelet filter before the post processing
+	* Guided by the normal, depth and albedo of the primary hits, so a usable image needs only a few samples per pixel.
+	* Not applied to the BVH heatmap.
+	* */
+	inline void setDenoiser(bool enabled, const DenoiserSettings& settings) { m_Denoiser = enabled; m_DenoiserSettings = settings; m_DenoiserSettings.iterations = std::clamp(settings.iterations, 1, 8); }
+	inline bool isDenoiser() const { return m_Denoiser; }
+	inline const DenoiserSettings& getDenoiserSettings() const { return m_DenoiserSettings; }
+
+	/**
+	* @brief Keeps the accumulated image through camera moves
+	* Every pixel continues the history of the pixel which saw its primary hit in the previous view,
+	* the depths of the primary hits reject the histories of the disoccluded pixels.
+	* The reprojected histories are capped at max_history_frames so the image can catch up with the motion.
+	* Only for the full frame modes (not the tiles or the adaptive sampling).
+	* */
+	inline void setTemporalReprojection(bool enabled, unsigned int max_history_frames) { m_TemporalReprojection = enabled; m_MaxHistoryFrames = std::max(max_history_frames, 1u); }
+	inline bool isTemporalReprojection() const { return m_TemporalReprojection; }
+	inline unsigned int getMaxHistoryFrames() const { return m_MaxHistoryFrames; }
+
+	/**
+	* @brief Samples one light (emissive sphere or triangle) with a shadow ray at every hit
+	* The light samples and the BSDF samples are combined by multiple importance sampling (power heuristic),
+	* so small and distant lights converge much faster while large lights stay as clean as before.
+	* Only switches the shaders when the scene has emissive primitives. Not applied to the BVH heatmap.
+	* */
+	inline void setNextEventEstimation(bool enabled) { m_NextEventEstimation = enabled; }
+	inline bool isNextEventEstimation() const { return m_NextEventEstimation; }
+	// emissive spheres and triangles in the light list
+	inline unsigned int getLightCount() const { return m_LightList[0]; }
+
+	/**
+	* @brief Ends paths early instead of always tracing the full bounce count
+	* From min_bounce bounces on, a path survives each bounce with a probability of its largest throughput component
+	* and the survivors are reweighted by it (Russian roulette, unbiased).
+	* Paths whose throughput fell below throughput_cutoff are dropped regardless (0 = never), their light is lost.
+	* */
+	inline void setPathTermination(bool russian_roulette, unsigned int min_bounce, float throughput_cutoff) { m_RussianRoulette = russian_roulette; m_RouletteMinBounce = min_bounce; m_ThroughputCutoff = std::max(throughput_cutoff, 0.0f); }
+	inline bool isRussianRoulette() const { return m_RussianRoulette; }
+	inline unsigned int getRouletteMinBounce() const { return m_RouletteMinBounce; }
+	inline float getThroughputCutoff() const { return m_ThroughputCutoff; }
+
+	/**
+	* @brief Splits the megakernel frame into tiles dispatched under a per-frame GPU time budget
+	* The image refines over several frames but the UI keeps its frame rate even with many rays per pixel.
+	* Every pixel counts its own accumulated frames (the alpha channel of the rtx texture), so accumulation advances per tile.
+	* */
+	inline void setTiledRendering(bool enabled, float frame_budget_ms) { m_TiledRendering = enabled; m_FrameBudgetMs = std::max(frame_budget_ms, 0.1f); }
+	inline bool isTiledRendering() const { return m_TiledRendering; }
+	inline float getFrameBudgetMs() const { return m_FrameBudgetMs; }
+	inline unsigned int getTilesPerFrame() const { return m_TilesPerFrame; }
+	unsigned int getTileCount() const;
+
+	/**
+	* @brief Spends the rays of the megakernel only on the pixels which didn't converge yet
+	* The running variance of every pixel (Welford, in the variance texture) gives the relative error of its mean,
+	* pixels under error_threshold (after at least min_frames frames) are skipped by the dispatch entirely.
+	* Takes precedence over the tiled rendering.
+	* */
+	inline void setAdaptiveSampling(bool enabled, float error_threshold, unsigned int min_frames) { m_AdaptiveSampling = enabled; m_ErrorThreshold = error_threshold; m_MinAccumulatedFrames = std::max(min_frames, 2u); }
+	inline bool isAdaptiveSampling() const { return m_AdaptiveSampling; }
+	inline float getErrorThreshold() const { return m_ErrorThreshold; }
+	inline unsigned int getMinAccumulatedFrames() const { return m_MinAccumulatedFrames; }
+	// pixels traced during a recent adaptive frame, lags a few frames behind
+	inline unsigned int getActivePixelCount() const { return m_ActivePixelCount; }
+
+	/**
+	* @brief Lowers the internal resolution while the accumulation is being reset every frame (camera motion)
+	* The resolution scale is chosen to keep the GPU time of the rtx stage around target_frame_ms,
+	* once the motion stops the full resolution is traced again and the accumulation restarts.
+	* Not used together with the tiled rendering (the tiles already keep the frame time).
+	* */
+	inline void setDynamicResolution(bool enabled, float target_frame_ms) { m_DynamicResolution = enabled; m_TargetFrameMs = std::max(target_frame_ms, 1.0f); }
+	inline bool isDynamicResolution() const { return m_DynamicResolution; }
+	inline float getTargetFrameMs() const { return m_TargetFrameMs; }
+	inline float getResolutionScale() const { return m_ResolutionScale; }
+
+	/**
+	* @brief Renders a frame (ray tracing, statistics, readbacks and post processing) through the render graph
+	* @return the post processed texture, ready to be sampled
+	* */
+	ComputeTexture* RenderFrame();
+	// memory barriers issued by the render graph during the last frame
+	inline unsigned int getLastBarrierCount() const { return m_RenderGraph.GetLastBarrierCount(); }
+
+	rtx_parameters_uniform_struct rtx_uniform_parameters{};
+
+	PixelData pixelData{}; // read back asynchronously, lags a few frames behind the rendered image
+
+	// the pixel-data setting selects the shader variants with the intersection counters, it changes rarely (a new variant per change)
+	inline void setShowPixelData(bool enabled) { m_ShowPixelData = enabled; }
+	// the pixel data readback only runs while enabled (while the pixel-data tooltip is shown), doesn't change the shaders
+	inline void setPixelDataReadback(bool enabled) { m_PixelDataReadback = enabled; }
+
+	postProcessing_parameters_uniform_struct postProcessing_uniform_parameters{};
 
 private:
 	// compute rtx stage
 	ComputeTexture* computeRtxTexture;
 	ComputeShader* computeRtxShader;
 
+	// wavefront passes
+	ComputeShader* wavefrontGenerateShader;
+	ComputeShader* wavefrontExtendShader;
+	ComputeShader* wavefrontShadeShader;
+	ComputeShader* wavefrontAccumulateShader;
+	ComputeShader* wavefrontDispatchArgsShader;
+
+	ComputeShader* computeRtxPersistentShader;
+
+	// adaptive sampling
+	ComputeTexture* varianceTexture;
+	ComputeShader* adaptiveAllocateShader;
+	ComputeShader* computeRtxAdaptiveShader;
+
 	// compute post processing stage
 	ComputeTexture* computePostProcTexture;
 	ComputeShader* computePostProcShader;
 
 	BVH::BVH_data BVH_of_mesh;
+	BVH::Node m_EmptyBVHRoot; // uploaded instead of the BVH while there is no mesh
 };
\ No newline at end of file
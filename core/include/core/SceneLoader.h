@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "core/ObjParser/ObjParser.h"
+
+/**
+* @brief The SceneLoader class
+* Imports a model and builds its BVH on a background thread, so the window and the
+* analytic part of the scene are available while the mesh is still loading.
+*
+* The main thread polls IsReady() every frame and hands the result to the
+* Renderer with Renderer::setMeshData (the GL upload has to happen on the thread that owns the context).
+* */
+class SceneLoader
+{
+public:
+	enum class Stage {
+		IDLE,
+		LOADING_MESH,
+		BUILDING_BVH,
+		READY,      // the result is waiting to be taken
+		FINISHED,   // the result has been taken
+		FAILED
+	};
+
+	SceneLoader();
+	~SceneLoader();
+
+	SceneLoader(const SceneLoader&) = delete;
+	SceneLoader& operator=(const SceneLoader&) = delete;
+
+	/**
+	* @brief Starts loading the model on the worker thread.
+	* The model is read through its .rtmesh cache (see MeshFile::getCached).
+	* A load which is still running is waited for first.
+	* */
+	void Start(const std::string& path, BVH::Heuristic heuristic);
+
+	/**
+	* @brief Starts loading a scene made of several models (see BVH::constructScene).
+	* */
+	void Start(const std::vector<BVH::ModelInstance>& models, BVH::Heuristic heuristic);
+
+	inline bool IsLoading() const { Stage stage = m_Stage.load(); return stage == Stage::LOADING_MESH || stage == Stage::BUILDING_BVH; }
+	inline bool IsReady() const { return m_Stage.load() == Stage::READY; }
+	inline Stage GetStage() const { return m_Stage.load(); }
+	const char* GetStageName() const;
+
+	/**
+	* @brief Moves the constructed BVH out of the loader (only valid when IsReady() is true).
+	* */
+	BVH::BVH_data TakeResult();
+
+	// overall progress in the range [0, 1]
+	inline float GetProgress() const { return m_Progress.load(); }
+	double GetElapsedSeconds() const;
+
+	/**
+	* @brief Estimated time left, extrapolated from the progress made so far.
+	* @return a negative value while there isn't enough progress for an estimate
+	* */
+	double GetEstimatedSecondsLeft() const;
+
+	inline const std::string& GetPath() const { return m_Path; }
+
+private:
+	void Run(std::vector<BVH::ModelInstance> models, BVH::Heuristic heuristic);
+
+	std::thread m_Worker;
+	std::atomic<Stage> m_Stage;
+	std::atomic<float> m_Progress;
+
+	std::chrono::steady_clock::time_point m_StartTime;
+	std::atomic<double> m_FinishedSeconds;
+
+	std::string m_Path;
+	BVH::BVH_data m_Result;
+};
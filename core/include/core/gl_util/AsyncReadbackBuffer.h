@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+/**
+* @brief The AsyncReadbackBuffer class
+* Reads small GPU buffers back to the CPU without stalling.
+* Enqueue() copies the source buffer into one slot of a persistently mapped ring and fences it,
+* TryRead() returns the newest slot the GPU has finished with (a few frames old) and never waits.
+* */
+class AsyncReadbackBuffer
+{
+public:
+	AsyncReadbackBuffer(size_t size, unsigned int slot_count = 3);
+	~AsyncReadbackBuffer();
+
+	AsyncReadbackBuffer(const AsyncReadbackBuffer&) = delete;
+	AsyncReadbackBuffer& operator=(const AsyncReadbackBuffer&) = delete;
+
+	/**
+	* @brief Queues a copy of size bytes of source_buffer (starting at source_offset)
+	* Shader writes to the source buffer have to be made visible with GL_BUFFER_UPDATE_BARRIER_BIT first.
+	* When every slot is still in flight the oldest copy is dropped.
+	* */
+	void Enqueue(unsigned int source_buffer, size_t source_offset = 0);
+
+	/**
+	* @brief Copies the newest finished readback into destination
+	* @return false if no new data arrived since the last successful call
+	* */
+	bool TryRead(void* destination);
+
+private:
+	struct Slot {
+		GLsync fence = nullptr;
+		unsigned long long sequence = 0;
+	};
+
+	unsigned int m_RendererID;
+	size_t m_Size;
+	size_t m_SlotStride;
+
+	std::vector<Slot> m_Slots;
+	unsigned int m_NextSlot;
+	unsigned long long m_NextSequence;
+
+	unsigned char* m_MappedPtr;
+};
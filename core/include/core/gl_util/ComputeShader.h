@@ -1,14 +1,36 @@
 #pragma once
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// preprocessor defines (name -> value) injected right after the #version line
+using ShaderDefines = std::map<std::string, std::string>;
 
 class ComputeShader {
 public:
-	ComputeShader(const std::string& filepath);
+	ComputeShader(const std::string& filepath, const ShaderDefines& defines = ShaderDefines());
 	~ComputeShader();
 
+	/**
+	* @brief Switches to the variant compiled with the given defines
+	* Every variant is compiled once (or loaded from the program binary cache) and kept until the shader is deleted,
+	* switching back to a known variant is free. Uniforms set through glProgramUniform are per variant.
+	* */
+	void SetDefines(const ShaderDefines& defines);
+	const ShaderDefines& GetDefines() const { return m_Defines; }
+
 	void Bind();
 	void Unbind();
+	// no memory barrier after the dispatch, the render graph (or the pass itself) emits the ones its readers need
 	void DrawCall(unsigned int workGroups_x, unsigned int workGroups_y, unsigned int workGroups_z);
+	// the work group counts are read from indirect_buffer (at offset) when the dispatch executes
+	void DrawCallIndirect(unsigned int indirect_buffer, size_t offset = 0);
+
+	void SetUniform1i(const std::string& name, int value);
+	void SetUniform1ui(const std::string& name, unsigned int value);
+	void SetUniform1f(const std::string& name, float value);
+	void SetUniform2i(const std::string& name, int x, int y);
 
 	unsigned int m_RendererID;
 	
@@ -17,11 +39,19 @@ public:
 	unsigned int workGroups_z;
 
 private:
-	const std::string& m_Filepath;
-
-	
+	std::string m_Filepath;
+	ShaderDefines m_Defines;
+	std::map<ShaderDefines, unsigned int> m_Variants;
+	std::unordered_map<std::string, int> m_UniformLocationCache; // of the active variant
 
 	unsigned int CreateShader();
-	std::string ParseShader(const std::string& filepath);
+	int GetUniformLocation(const std::string& name);
+
+	/**
+	* @brief Reads the shader source and expands #include "path" directives (paths are relative to the including file)
+	* Every file is included only once.
+	* */
+	std::string ParseShader(const std::string& filepath, std::unordered_set<std::string>& included_files);
+	std::string InjectDefines(const std::string& source) const;
 
 };
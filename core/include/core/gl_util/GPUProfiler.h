@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+* @brief The GPUProfiler class
+* Measures the GPU time of named zones (e.g. the renderer stages) with GL_TIMESTAMP queries.
+* Timestamps can nest and overlap the GL_TIME_ELAPSED ranges of the GPUTimers, unlike elapsed queries.
+* Every frame writes its queries into its own slot of a ring (frames in flight), a frame is resolved once
+* the GPU made all of its timestamps available, so reading the results never stalls.
+* The resolved frames are kept in a rolling history which can be exported to CSV.
+* */
+class GPUProfiler
+{
+public:
+	GPUProfiler(unsigned int frames_in_flight = 4, unsigned int history_length = 256);
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	// zone 0 ("Frame") spans from BeginFrame to EndFrame, EndFrame also resolves the finished frames
+	void BeginFrame();
+	void EndFrame();
+
+	/**
+	* @brief Zones may nest and repeat, the time of every occurrence within a frame is summed up
+	* Zones outside of BeginFrame / EndFrame are ignored.
+	* @param name - has to stay valid (string literal), zones are identified by name
+	* */
+	void BeginZone(const char* name);
+	void EndZone();
+
+	unsigned int GetZoneCount() const { return (unsigned int)m_ZoneNames.size(); }
+	const std::string& GetZoneName(unsigned int zone) const { return m_ZoneNames[zone]; }
+	float GetLatestMs(unsigned int zone) const { return m_Latest[zone]; }
+	// -1 if the zone wasn't recorded yet
+	int FindZone(const char* name) const;
+
+	/**
+	* @brief The rolling history of a zone (ms per frame) is a ring buffer
+	* GetHistoryOffset is the index of the oldest value (e.g. for ImGui::PlotLines values_offset).
+	* */
+	const std::vector<float>& GetHistory(unsigned int zone) const { return m_History[zone]; }
+	unsigned int GetHistoryOffset() const { return m_HistoryHead; }
+
+	// one row per resolved frame (oldest first), one column per zone
+	bool ExportCSV(const std::string& filepath) const;
+
+private:
+	struct ZoneRecord {
+		unsigned int zone;
+		unsigned int begin_query;
+		unsigned int end_query;
+	};
+
+	struct Frame {
+		std::vector<unsigned int> queries; // timestamp queries, the pool grows to the most zones seen in a frame
+		unsigned int used_queries = 0;
+		std::vector<ZoneRecord> zones;
+		unsigned long long number = 0; // 0 = no pending result
+	};
+
+	std::vector<Frame> m_Frames;
+	unsigned int m_CurrentFrame;
+	unsigned long long m_FrameNumber;
+	bool m_InFrame;
+	std::vector<unsigned int> m_OpenZones; // indices into the zones of the current frame
+
+	std::vector<std::string> m_ZoneNames;
+	std::vector<std::vector<float>> m_History;
+	std::vector<unsigned long long> m_HistoryFrames;
+	unsigned int m_HistoryLength;
+	unsigned int m_HistoryHead;
+	unsigned int m_HistoryCount;
+	std::vector<float> m_Latest;
+
+	unsigned int GetZoneIndex(const char* name);
+	unsigned int WriteTimestamp(Frame& frame);
+	bool Resolve(Frame& frame);
+	void ResolveFinishedFrames();
+};
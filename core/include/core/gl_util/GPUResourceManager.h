@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+/**
+* @brief The GPUBuffer class
+* A GL buffer mirroring a block of CPU memory (which it does not own).
+* The whole block is uploaded on the next Upload() after it was (re)set, nothing in between.
+* */
+class GPUBuffer
+{
+public:
+	GPUBuffer(GLenum target, unsigned int binding_point);
+	~GPUBuffer();
+
+	GPUBuffer(const GPUBuffer&) = delete;
+	GPUBuffer& operator=(const GPUBuffer&) = delete;
+
+	/**
+	* @brief Points the buffer at a new block of CPU memory, it is uploaded by the next Upload().
+	* The GL storage is only reallocated when the size changes.
+	* The memory has to stay valid until the next SetSource (or until the buffer is destroyed).
+	* */
+	void SetSource(const void* data, size_t size);
+
+	inline bool IsDirty() const { return m_Dirty; }
+
+	/**
+	* @brief Uploads the source if it was set since the last upload.
+	* @return the number of uploaded bytes
+	* */
+	size_t Upload();
+
+	inline unsigned int ID() const { return m_RendererID; }
+	inline size_t Size() const { return m_Size; }
+
+private:
+	void Allocate(size_t size);
+
+	unsigned int m_RendererID;
+	GLenum m_Target;
+	unsigned int m_BindingPoint;
+
+	const unsigned char* m_Source;
+	size_t m_Size;
+
+	bool m_Dirty;
+};
+
+/**
+* @brief The GPUResourceManager class
+* Owns the scene buffers used by the ray tracing stage and uploads the ones whose source was set since the last Flush()
+* (the scene and a swapped in mesh), frames without a new source upload nothing.
+* */
+class GPUResourceManager
+{
+public:
+	enum class Resource {
+		SPHERES,    // UBO  - binding point 1
+		MESH,       // SSBO - binding point 3
+		BVH,        // SSBO - binding point 4
+		COUNT
+	};
+
+	GPUResourceManager();
+
+	inline GPUBuffer& Get(Resource resource) { return *m_Buffers[static_cast<size_t>(resource)]; }
+
+	inline void SetSource(Resource resource, const void* data, size_t size) { Get(resource).SetSource(data, size); }
+
+	/**
+	* @brief Uploads every buffer with a new source
+	* Called once per frame before the dispatch, does nothing when no data changed.
+	* */
+	void Flush();
+
+	// bytes uploaded by the last Flush()
+	inline size_t GetLastUploadedBytes() const { return m_LastUploadedBytes; }
+
+private:
+	std::vector<std::unique_ptr<GPUBuffer>> m_Buffers;
+	size_t m_LastUploadedBytes;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+/**
+* @brief The GPUTimer class
+* Measures the GPU time of a range of commands with GL_TIME_ELAPSED queries without stalling.
+* The queries are used round robin, a result is only read once the GPU made it available (usually 1-3 frames later).
+* */
+class GPUTimer
+{
+public:
+	GPUTimer(unsigned int query_count = 4);
+	~GPUTimer();
+
+	GPUTimer(const GPUTimer&) = delete;
+	GPUTimer& operator=(const GPUTimer&) = delete;
+
+	// the tag is returned together with the result (e.g. how much work was measured)
+	void Begin(unsigned long long tag = 0);
+	void End();
+
+	/**
+	* @brief Returns the oldest measurement which is ready
+	* @return false if no measurement finished since the last call
+	* */
+	bool Poll(double& elapsed_ms, unsigned long long& tag);
+
+private:
+	struct Query {
+		unsigned int id = 0;
+		unsigned long long tag = 0;
+		unsigned long long sequence = 0; // 0 = no pending result
+	};
+
+	std::vector<Query> m_Queries;
+	unsigned int m_NextQuery;
+	unsigned long long m_NextSequence;
+};
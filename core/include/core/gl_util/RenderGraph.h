@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+class GPUProfiler;
+
+/**
+* @brief The RenderGraph class
+* The passes of a frame declare the textures and buffers they access, the graph then
+* - orders the passes, a pass runs after every earlier added pass it conflicts with (it or the other pass writes a shared resource),
+*   among the passes which are ready the ones that don't need a barrier run first (independent passes get reordered)
+* - emits only the glMemoryBarrier bits the accesses of a pass need to see the incoherent shader writes before it
+* - allocates the transient textures from a pool, transients whose lifetimes don't overlap share the same texture
+* The passes are added again every frame, the hazard state of the resources (pending shader writes) is kept between frames.
+* Barriers between the dispatches inside a single pass are up to the pass.
+* */
+class RenderGraph
+{
+public:
+	using Handle = unsigned int;
+
+	enum class Access {
+		IMAGE,		// imageLoad / imageStore / image atomics
+		STORAGE,	// shader storage buffer
+		UNIFORM,	// uniform buffer
+		INDIRECT,	// indirect dispatch arguments
+		TRANSFER,	// clears, copies and uploads (glClear*, glCopy*, glBufferSubData)
+		SAMPLE		// texture fetches (e.g. ImGui drawing the texture)
+	};
+
+	class Pass
+	{
+	public:
+		/**
+		* @param binding - the image unit the texture is bound to before the pass executes (IMAGE access), -1 = not rebound
+		* A TRANSFER write next to other accesses of the resource means the pass clears / uploads it before the shaders access it.
+		* */
+		Pass& Read(Handle resource, Access access, int binding = -1);
+		Pass& Write(Handle resource, Access access, int binding = -1);
+
+	private:
+		friend class RenderGraph;
+
+		struct ResourceAccess {
+			Handle resource;
+			Access access;
+			bool write;
+			int binding;
+		};
+
+		const char* m_Name;
+		std::function<void()> m_Execute;
+		std::vector<ResourceAccess> m_Accesses;
+	};
+
+	RenderGraph(GPUProfiler* profiler = nullptr);
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// importing the same GL object twice in a frame returns the same handle
+	Handle ImportTexture(unsigned int texture_id);
+	Handle ImportBuffer(unsigned int buffer_id);
+	// an rgba32f texture which only lives during the passes of this frame, its content is undefined until written
+	Handle CreateTransientTexture(int width, int height);
+
+	// the GL texture of a texture handle, for transients only valid inside the passes
+	unsigned int GetTextureID(Handle texture) const { return m_Resources[texture].id; }
+
+	// the name has to stay valid (string literal), it is also the profiler zone of the pass
+	Pass& AddPass(const char* name, std::function<void()> execute);
+
+	// an access after the graph (e.g. ImGui sampling the output), its barrier is emitted at the end of Execute
+	void Export(Handle resource, Access access);
+
+	void Execute();
+
+	inline unsigned int GetLastBarrierCount() const { return m_LastBarrierCount; }
+	inline unsigned int GetTransientTextureCount() const { return (unsigned int)m_TexturePool.size(); }
+
+private:
+	struct Resource {
+		bool texture;
+		bool transient;
+		unsigned int id;	// GL name (transients: assigned by Execute)
+		int width, height;	// transients
+		int first_pass, last_pass; // lifetime in the execution order
+	};
+
+	// incoherent shader writes are visible to an access once a barrier with its bit was issued after the write
+	struct HazardState {
+		bool pending_write = false;
+		GLbitfield visible_bits = 0;
+	};
+	using HazardStates = std::unordered_map<uint64_t, HazardState>;
+
+	struct PooledTexture {
+		unsigned int id;
+		int width, height;
+		int busy_until;		// last pass of the transient using it this frame, -1 = free
+		unsigned int unused_frames;
+	};
+
+	GPUProfiler* m_Profiler;
+
+	std::vector<Resource> m_Resources;
+	std::deque<Pass> m_Passes;
+	std::vector<std::pair<Handle, Access>> m_Exports;
+
+	HazardStates m_States;
+	std::vector<PooledTexture> m_TexturePool;
+	unsigned int m_LastBarrierCount;
+
+	Handle Import(bool texture, unsigned int id);
+	uint64_t StateKey(Handle resource, bool scheduling) const;
+	static bool IsReset(const Pass& pass, Handle resource);
+	GLbitfield RequiredBarrier(const Pass& pass, const HazardStates& states, bool scheduling) const;
+	void IssueBarrier(GLbitfield bits, HazardStates& states) const;
+	void MarkWrites(const Pass& pass, HazardStates& states, bool scheduling) const;
+
+	std::vector<unsigned int> Schedule() const;
+	void AllocateTransients(const std::vector<unsigned int>& order);
+};
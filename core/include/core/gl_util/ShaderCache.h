@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+* @brief The ShaderCache class
+* Stores linked program binaries on disk (CORE_SHADER_CACHE_PATH) so warm starts skip the GLSL compilation.
+* The key covers the expanded source (including the injected defines) and the driver (vendor, renderer, version),
+* any change produces a new key so a stale binary is never loaded. A binary the driver rejects falls back to a source compile.
+* */
+class ShaderCache
+{
+public:
+	static uint64_t ComputeKey(const std::string& expanded_source);
+
+	/**
+	* @brief Creates a program from the cached binary
+	* @return the program ID, 0 if there is no usable binary for the key
+	* */
+	static unsigned int Load(uint64_t key);
+
+	// the program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static void Store(unsigned int program, uint64_t key);
+
+private:
+	static std::string GetPath(uint64_t key);
+};
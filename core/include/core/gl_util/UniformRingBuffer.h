@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+/**
+* @brief The UniformRingBuffer class
+* A persistently mapped uniform buffer split into slots which are used round robin.
+* Every Push() writes one whole block into the next slot and binds that slot with glBindBufferRange,
+* a fence protects each slot so it is never overwritten while the GPU may still read it.
+* */
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer(size_t block_size, unsigned int binding_point, unsigned int slot_count = 3);
+	~UniformRingBuffer();
+
+	UniformRingBuffer(const UniformRingBuffer&) = delete;
+	UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+	/**
+	* @brief Copies block_size bytes into the next free slot and binds it to the binding point
+	* Only blocks when the GPU is more than slot_count pushes behind.
+	* */
+	void Push(const void* block);
+
+private:
+	unsigned int m_RendererID;
+	unsigned int m_BindingPoint;
+
+	size_t m_BlockSize;
+	size_t m_SlotStride; // block size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	unsigned int m_SlotCount;
+	unsigned int m_CurrentSlot;
+
+	unsigned char* m_MappedPtr;
+	std::vector<GLsync> m_Fences;
+};
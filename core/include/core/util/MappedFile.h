@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/**
+* @brief The MappedFile class
+* Maps a whole file into memory as read-only. The mapped bytes stay valid for
+* the lifetime of the object, so data can be handed straight to glBufferData
+* without being copied into an intermediate buffer first.
+* */
+class MappedFile
+{
+public:
+	MappedFile(const std::string& filepath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline bool IsOpen() const { return m_Data != nullptr; }
+	inline const char* Data() const { return m_Data; }
+	inline size_t Size() const { return m_Size; }
+
+private:
+	const char* m_Data;
+	size_t m_Size;
+
+#ifdef _WIN32
+	void* m_FileHandle;
+	void* m_MappingHandle;
+#else
+	int m_FileDescriptor;
+#endif
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <thread>
+
+/**
+ * Minimal fork-join helpers used by the CPU side of the renderer (mesh loading, BVH building).
+ * The work is spread over one process wide pool of workerCount() - 1 threads, the calling thread helps as well.
+ * Calls nested in a task of another call submit their tasks into the same pool, so the nested work
+ * (e.g. the parsing and the BVH build inside a task per model) keeps every core busy without oversubscribing them.
+ */
+namespace Parallel {
+
+    // Number of threads the helpers below spread the work over
+    inline unsigned int workerCount()
+    {
+        unsigned int count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    namespace detail {
+        // hands the tasks to the pool and returns once every one of them is done
+        void run(size_t task_count, const std::function<void(size_t)>& task);
+    }
+
+    /**
+     * @brief Runs task(i) for every i in [0, task_count).
+     * Tasks are handed out dynamically, so they don't need to be of similar size.
+     */
+    template <typename Task>
+    void forEach(size_t task_count, const Task& task)
+    {
+        if (task_count <= 1 || workerCount() <= 1) {
+            for (size_t i = 0; i < task_count; i++) { task(i); }
+            return;
+        }
+        detail::run(task_count, [&task](size_t i) { task(i); });
+    }
+
+    /**
+     * @brief Splits [0, count) into contiguous ranges and runs range_task(begin, end) on each of them.
+     * @param min_range_size ranges are never smaller than this (avoids spawning threads for tiny inputs)
+     */
+    template <typename RangeTask>
+    void forRanges(size_t count, const RangeTask& range_task, size_t min_range_size = 1024)
+    {
+        size_t range_count = std::max<size_t>(1, std::min<size_t>(workerCount() * 4, count / std::max<size_t>(1, min_range_size)));
+        forEach(range_count, [&](size_t range) {
+            size_t begin = count * range / range_count;
+            size_t end = count * (range + 1) / range_count;
+            if (begin < end) {
+                range_task(begin, end);
+            }
+        });
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Scoped CPU zones recorded into per-thread ring buffers and exported as Chrome trace-event JSON
+ * (open the file in chrome://tracing or https://ui.perfetto.dev).
+ * - PROFILE_SCOPE(name) measures the enclosing scope, the name has to be a string literal
+ * - the zones are compiled out unless CORE_PROFILING is defined (CMake option CORE_PROFILING),
+ *   when compiled in but not recording a zone costs one relaxed atomic load
+ * - every thread writes only its own ring buffer, the oldest zones are overwritten when it is full
+ * - the export and clear may run while other threads have zones open, every buffer is locked while it is read or reset
+ */
+namespace Profiler {
+
+    void setRecording(bool recording);
+    bool isRecording();
+
+    // shown as the thread name on the timeline (e.g. "Main", "Scene loader")
+    void setThreadName(const char* name);
+
+    // drops every recorded zone
+    void clear();
+
+    /**
+     * @brief Writes the recorded zones of every thread as Chrome trace-event JSON
+     * The recording is paused during the export, zones closing meanwhile are dropped.
+     */
+    bool exportChromeTrace(const std::string& filepath);
+
+    // nanoseconds since the start of the profiler (steady clock)
+    uint64_t nowNs();
+
+    void recordZone(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* name)
+            : m_Name(name), m_Begin(isRecording() ? nowNs() : 0) {}
+        ~ScopedZone()
+        {
+            if (m_Begin != 0) {
+                recordZone(m_Name, m_Begin, nowNs());
+            }
+        }
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* m_Name;
+        uint64_t m_Begin; // 0 = not recording
+    };
+}
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef CORE_PROFILING
+#define PROFILE_SCOPE(name) Profiler::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
@@ -0,0 +1,22 @@
+/**
+ * Declarations shared by the adaptive sampling passes (adaptive/Allocate.comp and ComputeRayTracingAdaptive.comp)
+ * - the allocation pass lists the pixels which still need samples, the tracing pass is dispatched indirectly over the list
+ * - MUST be exactly the same as the buffer allocated by the Renderer (16 bytes + 4 bytes per pixel)
+ */
+
+#define ADAPTIVE_GROUP_SIZE 64
+
+/** The first three members are the indirect dispatch arguments of the tracing pass.
+ * The renderer resets them to (0, 1, 1) and active_pixel_count to 0 every frame.
+ */
+layout (std430, binding = 11) buffer ActivePixels
+{
+    uint num_groups_x;
+    uint num_groups_y;
+    uint num_groups_z;
+    uint active_pixel_count;
+    uint active_pixels[]; // y << 16 | x
+};
+
+uniform float u_errorThreshold;     // relative error under which a pixel is converged
+uniform uint u_minAccumulatedFrames; // frames every pixel gets before its error estimate is trusted
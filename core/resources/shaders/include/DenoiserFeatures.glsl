@@ -0,0 +1,22 @@
+/**
+ * Feature images of the denoiser (only compiled in with DENOISER_FEATURES)
+ * - the tracing shaders write the primary hit of every pixel (the camera ray is the same for every sample of a pixel)
+ * - denoise/Atrous.comp stops the filter at the edges of the geometry (normal, depth) and of the materials (albedo)
+ */
+
+layout (rgba32f, binding = 4) uniform image2D featureTexture; // .xyz = world space normal, .w = distance from the camera (-1 = sky)
+layout (rgba32f, binding = 5) uniform image2D albedoTexture;  // .rgb = color of the hit material (1 for the sky)
+
+void StoreDenoiserFeatures(ivec2 texelCoords, bool didCollide, vec3 normal, float depth, vec3 albedo)
+{
+    if (didCollide)
+    {
+        imageStore(featureTexture, texelCoords, vec4(normal, depth));
+        imageStore(albedoTexture, texelCoords, vec4(albedo, 1.0));
+    }
+    else
+    {
+        imageStore(featureTexture, texelCoords, vec4(0.0, 0.0, 0.0, -1.0));
+        imageStore(albedoTexture, texelCoords, vec4(1.0));
+    }
+}
@@ -0,0 +1,170 @@
+/**
+ * Next event estimation (only compiled in with NEXT_EVENT_ESTIMATION)
+ * - every hit picks one light (an emissive sphere or an emissive triangle) uniformly, samples a point on it
+ *   and traces a shadow ray towards it
+ * - the light samples and the cosine weighted BSDF samples are combined with multiple importance sampling (power heuristic):
+ *   a BSDF ray which hits a light is weighted against the pdf of sampling the same direction through the light list
+ * - the camera ray has no light sample to be combined with, the light it hits keeps the full weight
+ */
+
+// MUST match the light list built by the renderer (Renderer::update_light_list)
+layout (std430, binding = 13) readonly buffer LightList
+{
+    uint light_count;           // emissive spheres + emissive triangles
+    uint light_sphere_count;    // the first light_sphere_count entries are indices into u_Spheres, the rest indices into MESH
+    uint light_padding[2];
+    uint lights[];
+};
+
+#define SHADOW_RAY_OFFSET 1.0e-3 // along the normal, the shadow ray mustn't hit the surface it starts from
+
+struct LightSample
+{
+    vec3 dir;           // from the shaded point towards the light (normalized)
+    float dst;          // distance to the sampled point on the light
+    vec3 radiance;      // emitted radiance of the light
+    float pdf;          // solid angle pdf, including the choice of the light
+};
+
+/** The SphereConeSolidAngle function returns 2 * PI * (1 - cos(theta_max)) of the cone of directions from point which hit the sphere,
+ * 0.0 when the point lies inside of the sphere. It is computed from sin^2 to stay accurate for small and distant lights.
+ */
+float SphereConeSolidAngle(vec3 point, Sphere sphere)
+{
+    vec3 toCenter = sphere.position - point;
+    float dist2 = dot(toCenter, toCenter);
+    float radius2 = sphere.radius * sphere.radius;
+    if (dist2 <= radius2)
+    {
+        return 0.0;
+    }
+    float sin2ThetaMax = radius2 / dist2;
+    float cosThetaMax = sqrt(1.0 - sin2ThetaMax);
+    return 2.0 * PI * sin2ThetaMax / (1.0 + cosThetaMax);
+}
+
+/** The TriangleLightPdf function returns the solid angle pdf of sampling the triangle uniformly by area from point,
+ * for the direction dir which hits it at the distance dst (0.0 when the triangle faces away, the intersection is back-face culled).
+ */
+float TriangleLightPdf(vec3 dir, float dst, Triangle tri)
+{
+    vec3 areaNormal = cross(tri.v2 - tri.v1, tri.v3 - tri.v1); // length = 2 * area
+    float doubleArea = length(areaNormal);
+    if (doubleArea <= 0.0)
+    {
+        return 0.0;
+    }
+    return AreaToSolidAnglePdf(2.0 / doubleArea, dst, -dot(dir, areaNormal) / doubleArea);
+}
+
+/** The LightPdf function returns the pdf with which the light sampling from point would have chosen the direction of a BSDF ray
+ * that hit the emissive primitive of hit. Every emissive primitive is in the light list.
+ */
+float LightPdf(vec3 point, vec3 dir, HitInfo hit)
+{
+    if (light_count == 0u)
+    {
+        return 0.0;
+    }
+
+    float pdf = 0.0;
+    if (hit.objectIndex < 0)
+    {
+        float solidAngle = SphereConeSolidAngle(point, u_Spheres[-hit.objectIndex - 1]);
+        pdf = solidAngle > 0.0 ? 1.0 / solidAngle : 0.0;
+    }
+    else
+    {
+        pdf = TriangleLightPdf(dir, hit.dst, MESH[hit.objectIndex]);
+    }
+    return pdf / float(light_count);
+}
+
+/** The SampleLight function picks one light uniformly and samples a direction towards it from point:
+ * spheres uniformly within the cone they subtend, triangles uniformly by area.
+ * Returns false when the sample carries no light (the point is inside of the sphere, or the triangle faces away).
+ */
+bool SampleLight(vec3 point, inout uint state, out LightSample lightSample)
+{
+    uint light = min(uint(RandomValue(state) * float(light_count)), light_count - 1u);
+    uint index = lights[light];
+
+    if (light < light_sphere_count)
+    {
+        Sphere sphere = u_Spheres[index];
+        float solidAngle = SphereConeSolidAngle(point, sphere);
+        if (solidAngle <= 0.0)
+        {
+            return false;
+        }
+
+        vec3 toCenter = sphere.position - point;
+        float dist2 = dot(toCenter, toCenter);
+        float oneMinusCosThetaMax = solidAngle / (2.0 * PI);
+        lightSample.dir = SampleUniformCone(toCenter * inversesqrt(dist2), oneMinusCosThetaMax, state);
+
+        // the near intersection with the sphere along the sampled direction
+        float projection = dot(toCenter, lightSample.dir);
+        float discriminant = max(sphere.radius * sphere.radius - (dist2 - projection * projection), 0.0);
+        lightSample.dst = projection - sqrt(discriminant);
+        lightSample.radiance = sphere.material.emissionColor * sphere.material.emissionStrength;
+        lightSample.pdf = UniformConePdf(oneMinusCosThetaMax);
+    }
+    else
+    {
+        Triangle tri = MESH[index];
+        vec3 lightPoint = SampleTriangle(tri.v1, tri.v2, tri.v3, state);
+
+        vec3 toLight = lightPoint - point;
+        lightSample.dst = length(toLight);
+        if (lightSample.dst <= 0.0)
+        {
+            return false;
+        }
+        lightSample.dir = toLight / lightSample.dst;
+        lightSample.radiance = tri.material.emissionColor * tri.material.emissionStrength;
+        lightSample.pdf = TriangleLightPdf(lightSample.dir, lightSample.dst, tri);
+        if (lightSample.pdf <= 0.0)
+        {
+            return false;
+        }
+    }
+
+    lightSample.pdf /= float(light_count);
+    return true;
+}
+
+/** The SampleDirectLight function returns the light arriving at the hit from one light sample through a shadow ray,
+ * times the Lambertian BRDF (without the albedo) and the cosine, MIS weighted against the BSDF sampling.
+ * The caller multiplies it by the throughput and the albedo. traced_rays is incremented for every traced shadow ray.
+ */
+vec3 SampleDirectLight(HitInfo hit, inout uint state, inout uint AABB_intersect_count, inout uint TRI_intersect_count, inout uint traced_rays)
+{
+    LightSample lightSample;
+    if (light_count == 0u || !SampleLight(hit.hitPoint, state, lightSample))
+    {
+        return vec3(0.0);
+    }
+
+    float cosSurface = dot(hit.normal, lightSample.dir);
+    if (cosSurface <= 0.0)
+    {
+        return vec3(0.0);
+    }
+
+    Ray shadowRay;
+    shadowRay.origin = hit.hitPoint + hit.normal * SHADOW_RAY_OFFSET;
+    shadowRay.dir = lightSample.dir;
+
+    // anything in front of the light (stopping short of it, up to the offset of the origin) blocks the sample
+    float maxDst = lightSample.dst * (1.0 - 1.0e-3) - SHADOW_RAY_OFFSET;
+    bool occluded = CheckRayOcclusion(shadowRay, maxDst, AABB_intersect_count, TRI_intersect_count);
+    traced_rays++;
+    if (occluded)
+    {
+        return vec3(0.0);
+    }
+
+    float bsdfPdf = CosineHemispherePdf(cosSurface);
+    return lightSample.radiance * (bsdfPdf / lightSample.pdf) * PowerHeuristic(lightSample.pdf, bsdfPdf);
+}
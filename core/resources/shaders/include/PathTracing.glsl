@@ -0,0 +1,150 @@
+/**
+ * Path tracing of a whole pixel by one invocation
+ * - shared by the megakernel (ComputeRayTracing.comp) and the persistent threads variant (ComputeRayTracingPersistent.comp)
+ * - included after include/RayTracingCommon.glsl
+ */
+
+uint traced_ray_count = 0; // rays traced by this invocation, added to u_rayCount once at the end
+#if TRAVERSAL_STATS
+uint traced_bounce_count = 0; // rays which hit a surface and were scattered
+#endif
+#if DENOISER_FEATURES || TEMPORAL_REPROJECTION
+HitInfo primary_hit; // the first hit of the last traced path, the same for every path of the pixel
+#endif
+
+/** The TraceRay function traces a ray through the scene and calculates the color of the ray based on the objects it intersects.
+ * The function iterates over each bounce of the ray and calculates the color of the ray based on the material properties of the objects it intersects.
+ * The function uses the CheckRayCollision function to find the closest intersection of the ray with the objects in the scene.
+ * The function calculates the color of the ray based on the material properties of the objects it intersects.
+ */
+vec3 TraceRay(Ray ray, inout uint state, inout uint AABB_intersect_count, inout uint TRI_intersect_count)
+{
+    vec3 rayColor = vec3(1.0);
+    vec3 brightness_score = vec3(0.0);
+    HitInfo current_collision;
+#if NEXT_EVENT_ESTIMATION
+    float bsdf_pdf = 0.0; // solid angle pdf of the current ray, 0 for the camera ray (no light sample to be weighted against)
+#endif
+    
+    for (int i = 0; i <= RAY_BOUNCE_COUNT; i++)
+    {
+        CheckRayCollision(ray, current_collision, AABB_intersect_count, TRI_intersect_count);
+        traced_ray_count++;
+#if DENOISER_FEATURES || TEMPORAL_REPROJECTION
+        if (i == 0)
+        {
+            primary_hit = current_collision;
+        }
+#endif
+        if (current_collision.didCollide)
+        {
+#if TRAVERSAL_STATS
+            traced_bounce_count++;
+#endif
+            vec3 emittedLight = current_collision.material.emissionColor * current_collision.material.emissionStrength;
+#if NEXT_EVENT_ESTIMATION
+            if (bsdf_pdf > 0.0 && dot(emittedLight, emittedLight) > 0.0)
+            {
+                emittedLight *= PowerHeuristic(bsdf_pdf, LightPdf(ray.origin, ray.dir, current_collision));
+            }
+            if (i < RAY_BOUNCE_COUNT) // the last bounce traces no BSDF ray to be combined with
+            {
+                vec3 directLight = SampleDirectLight(current_collision, state, AABB_intersect_count, TRI_intersect_count, traced_ray_count);
+                brightness_score += directLight * rayColor * current_collision.material.color;
+            }
+#endif
+
+            ray.origin = current_collision.hitPoint;
+            ray.dir = SampleCosineHemisphere(current_collision.normal, state); // the Lambertian BRDF, its cosine cancels with the pdf
+#if NEXT_EVENT_ESTIMATION
+            bsdf_pdf = CosineHemispherePdf(dot(current_collision.normal, ray.dir));
+#endif
+            
+            brightness_score += emittedLight * rayColor;
+            rayColor *= current_collision.material.color;
+            if (i < RAY_BOUNCE_COUNT && !ContinuePath(rayColor, uint(i + 1), state))
+            {
+                break;
+            }
+        }
+        else
+        {
+            brightness_score += GainSkyboxLight(ray) * rayColor;
+            break;
+        }
+    }
+    return brightness_score;
+}
+
+/** The RenderPixel function traces all the rays of one pixel and accumulates the result into the ray tracing texture.
+ * The color of the pixel is accumulated over multiple frames to reduce noise in the image overtime.
+ */
+void RenderPixel(ivec2 texelCoords, ivec2 dims)
+{
+    float x = (float(texelCoords.x * 2 - dims.x) / dims.x); // transforms to [-1.0, 1.0]
+    float y = (float(texelCoords.y * 2 - dims.y) / dims.x); // deviding by x to keep the ratio
+    
+    uint accumulatedFrames = GetAccumulatedFrames(texelCoords);
+    uint state = getCurrentState(texelCoords, dims.x, accumulatedFrames);
+    
+    // applying transformation (camera rotation)
+    Ray ray;
+    ray.dir = normalize(vec3(x, y, u_FocalLength));
+    ray.dir = (u_ModelMatrix * vec4(ray.dir, 1.0f)).rgb; // apply the rotation transformation of the camera
+    ray.origin = u_CameraPos.xyz;
+
+    uint AABB_intersect_count = 0; 
+    uint TRI_intersect_count = 0;
+#if TRAVERSAL_STATS
+    // an invocation may render several pixels (persistent threads), the counters keep running
+    uint first_ray = traced_ray_count;
+    uint first_bounce = traced_bounce_count;
+#endif
+
+    // The actual tracing of the ray
+    vec3 tracingResult = vec3(0.0);
+    for (int i = 0; i < RAYS_PER_PIXEL_COUNT; i++)
+    {
+        tracingResult += TraceRay(ray, state, AABB_intersect_count, TRI_intersect_count);
+    }
+
+    // averaging the current frame accumulated pixel color
+#if DISPLAY_BVH
+    tracingResult = complexityToRGB(AABB_intersect_count + 3*TRI_intersect_count);
+#else
+    tracingResult = tracingResult / RAYS_PER_PIXEL_COUNT;
+    UpdateVariance(texelCoords, tracingResult, accumulatedFrames);
+#endif
+
+    vec4 accumulatedColor = imageLoad(rayTracingTexture, texelCoords);
+#if TEMPORAL_REPROJECTION
+    float primaryDepth = primary_hit.didCollide ? primary_hit.dst : -1.0;
+    imageStore(depthTexture, texelCoords, vec4(primaryDepth));
+    if (u_reprojectHistory > 0)
+    {
+        accumulatedColor = ReprojectHistory(ray.dir, primaryDepth);
+        accumulatedFrames = uint(accumulatedColor.a);
+    }
+#endif
+    
+    // averaging the previous & current frame pixel color
+    float weight = 1.0f / (accumulatedFrames + 1);
+    vec3 outputColor = accumulatedColor.rgb * (1 - weight) + tracingResult * weight;
+
+    imageStore(rayTracingTexture, texelCoords, vec4(outputColor, accumulatedFrames + 1)); // .a = number of accumulated frames
+
+#if DENOISER_FEATURES
+    StoreDenoiserFeatures(texelCoords, primary_hit.didCollide, primary_hit.normal, primary_hit.dst, primary_hit.material.color);
+#endif
+
+#if TRAVERSAL_STATS
+    imageStore(statsTexture, texelCoords, vec4(traced_ray_count - first_ray, traced_bounce_count - first_bounce, AABB_intersect_count, TRI_intersect_count));
+#endif
+
+#if DEBUG_COUNTERS
+    if (texelCoords == ivec2(u_pixelGlobalInvocationID.xy)) {
+        pixelData.pixelColor = vec4(outputColor, TRI_intersect_count); // store the color & the num of tri-ray intersections
+	    pixelData.AABB_intersect_count = AABB_intersect_count; // store the num of AABB-ray intersections
+    }
+#endif
+}
@@ -0,0 +1,69 @@
+/**
+ * Temporal reprojection (only compiled in with TEMPORAL_REPROJECTION)
+ * - the tracing shaders write the distance of the primary hit of every pixel into depthTexture
+ * - on a frame after a camera move the renderer copies the accumulated image and the depths into the history images
+ *   and sets u_reprojectHistory, every pixel then continues the history of the pixel which saw the same point
+ *   in the previous view instead of starting from zero
+ * - a history whose depth doesn't match (disocclusion) or which lies outside of the previous view is rejected
+ */
+
+// GL guarantees only 8 image units, the units of the post processing (1) and of the denoiser (6, 7) are reused,
+// the render graph binds the textures of every pass
+layout (rgba32f, binding = 6) uniform image2D historyTexture;       // the accumulated image of the previous frame (.a = accumulated frames)
+layout (rgba32f, binding = 1) uniform image2D depthTexture;         // .r = distance of the primary hit from the camera (-1 = sky)
+layout (rgba32f, binding = 7) uniform image2D historyDepthTexture;  // depthTexture of the previous frame
+
+#define REPROJECTION_DEPTH_TOLERANCE 0.02 // relative to the distance from the previous camera
+
+/** The CameraRayDirection function returns the direction of the primary ray of the pixel (the same as the ray generation).
+ */
+vec3 CameraRayDirection(ivec2 texelCoords, ivec2 dims)
+{
+    float x = (float(texelCoords.x * 2 - dims.x) / dims.x);
+    float y = (float(texelCoords.y * 2 - dims.y) / dims.x);
+    vec3 dir = normalize(vec3(x, y, u_FocalLength));
+    return (u_ModelMatrix * vec4(dir, 1.0f)).rgb;
+}
+
+/** The ReprojectHistory function projects the primary hit of the pixel (or its sky direction) into the previous view
+ * and returns the history found there: .rgb = accumulated color, .a = accumulated frames (at most u_reprojectHistory),
+ * vec4(0.0) when the history is rejected.
+ * The camera matrix is a rotation, its transpose takes world directions into the previous camera space.
+ */
+vec4 ReprojectHistory(vec3 dir, float depth)
+{
+    bool sky = depth < 0.0;
+    vec3 worldPoint = u_CameraPos + dir * depth;
+    vec3 local = transpose(mat3(u_prevModelMatrix)) * (sky ? dir : worldPoint - u_prevCameraPos);
+    if (local.z <= 0.0)
+    {
+        return vec4(0.0);
+    }
+
+    // inverse of the ray generation: dir ~ (x, y, focal length), x in [-1, 1], y scaled by the width
+    ivec2 dims = u_renderSize;
+    vec2 xy = local.xy / local.z * u_prevFocalLength;
+    ivec2 previousTexel = ivec2(round(vec2(xy.x * dims.x + dims.x, xy.y * dims.x + dims.y) * 0.5));
+    if (any(lessThan(previousTexel, ivec2(0))) || any(greaterThanEqual(previousTexel, dims)))
+    {
+        return vec4(0.0);
+    }
+
+    float previousDepth = imageLoad(historyDepthTexture, previousTexel).r;
+    if (sky != (previousDepth < 0.0))
+    {
+        return vec4(0.0);
+    }
+    if (!sky)
+    {
+        float expectedDepth = length(worldPoint - u_prevCameraPos);
+        if (abs(previousDepth - expectedDepth) > REPROJECTION_DEPTH_TOLERANCE * expectedDepth)
+        {
+            return vec4(0.0);
+        }
+    }
+
+    vec4 history = imageLoad(historyTexture, previousTexel);
+    history.a = min(history.a, float(u_reprojectHistory));
+    return history;
+}
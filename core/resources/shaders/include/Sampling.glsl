@@ -0,0 +1,88 @@
+/**
+ * Sampling of directions and points, every function comes with the pdf of what it samples
+ * - included by include/RayTracingCommon.glsl after RandomValue
+ * - directions are built from two uniform random numbers by a 2D mapping, rotated into place by an orthonormal basis
+ * - solid angle pdfs unless noted otherwise
+ */
+
+/** The OrthonormalBasis function builds two tangents to the normalized vector n (Duff et al. 2017, no singularity).
+ */
+void OrthonormalBasis(vec3 n, out vec3 tangent, out vec3 bitangent)
+{
+    float s = n.z >= 0.0 ? 1.0 : -1.0;
+    float a = -1.0 / (s + n.z);
+    float b = n.x * n.y * a;
+    tangent = vec3(1.0 + s * n.x * n.x * a, s * b, -s * n.x);
+    bitangent = vec3(b, s + n.y * n.y * a, -n.y);
+}
+
+/** The LocalToWorld function rotates a direction given around the z axis into the frame around the normalized vector n.
+ */
+vec3 LocalToWorld(vec3 local, vec3 n)
+{
+    vec3 tangent, bitangent;
+    OrthonormalBasis(n, tangent, bitangent);
+    return tangent * local.x + bitangent * local.y + n * local.z;
+}
+
+/** The SampleCosineHemisphere function returns a direction in the hemisphere around the normal, cosine-weighted
+ * (Malley's method: a uniform point on the unit disk projected up onto the hemisphere).
+ * The pdf is CosineHemispherePdf(dot(normal, direction)), which cancels the cosine of the Lambertian BRDF.
+ */
+vec3 SampleCosineHemisphere(vec3 normal, inout uint state)
+{
+    float u1 = RandomValue(state);
+    float phi = 2.0 * PI * RandomValue(state);
+    float r = sqrt(u1);
+    vec3 local = vec3(r * cos(phi), r * sin(phi), sqrt(max(1.0 - u1, 0.0)));
+    return LocalToWorld(local, normal);
+}
+
+float CosineHemispherePdf(float cosTheta)
+{
+    return max(cosTheta, 0.0) / PI;
+}
+
+/** The SampleUniformCone function returns a uniformly distributed direction within the cone around the normalized axis,
+ * the cone is given by 1 - cos(theta_max) (accurate for narrow cones, where cos(theta_max) rounds to 1).
+ * The pdf is UniformConePdf(oneMinusCosThetaMax).
+ */
+vec3 SampleUniformCone(vec3 axis, float oneMinusCosThetaMax, inout uint state)
+{
+    float oneMinusCosTheta = RandomValue(state) * oneMinusCosThetaMax;
+    float sinTheta = sqrt(max(oneMinusCosTheta * (2.0 - oneMinusCosTheta), 0.0));
+    float phi = 2.0 * PI * RandomValue(state);
+    vec3 local = vec3(sinTheta * cos(phi), sinTheta * sin(phi), 1.0 - oneMinusCosTheta);
+    return normalize(LocalToWorld(local, axis));
+}
+
+float UniformConePdf(float oneMinusCosThetaMax)
+{
+    return 1.0 / (2.0 * PI * oneMinusCosThetaMax);
+}
+
+/** The SampleTriangle function returns a uniformly distributed point on the triangle (v1, v2, v3),
+ * the area pdf is 1 / area (AreaToSolidAnglePdf converts it).
+ */
+vec3 SampleTriangle(vec3 v1, vec3 v2, vec3 v3, inout uint state)
+{
+    float su = sqrt(RandomValue(state));
+    float v = RandomValue(state);
+    return v1 * (1.0 - su) + v2 * (su * (1.0 - v)) + v3 * (su * v);
+}
+
+/** The AreaToSolidAnglePdf function converts an area pdf of a point at the distance dst into a solid angle pdf,
+ * cosLight is the cosine between the direction towards the point and the surface normal there (0 when it faces away).
+ */
+float AreaToSolidAnglePdf(float areaPdf, float dst, float cosLight)
+{
+    return cosLight > 0.0 ? areaPdf * dst * dst / cosLight : 0.0;
+}
+
+/** The PowerHeuristic function returns the MIS weight of a sample with pdf_a against the other strategy with pdf_b (beta = 2).
+ */
+float PowerHeuristic(float pdf_a, float pdf_b)
+{
+    float a2 = pdf_a * pdf_a;
+    return a2 / (a2 + pdf_b * pdf_b);
+}
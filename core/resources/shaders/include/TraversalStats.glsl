@@ -0,0 +1,19 @@
+/**
+ * Traversal statistics (only compiled in with TRAVERSAL_STATS, the renderer clears the image and the totals every frame)
+ * - the tracing shaders write the work of every pixel into statsTexture
+ * - stats/Reduce.comp sums it up into the frame totals and the cost histogram, read back by the renderer
+ * - MUST be exactly the same as traversal_stats_SSBO_struct in the c++ code
+ */
+
+#define STATS_HISTOGRAM_BINS 32
+
+// work of the pixel during the current frame: .r = rays, .g = bounces, .b = node visits (interior AABB hits), .a = triangle intersections
+layout (rgba32f, binding = 3) uniform image2D statsTexture;
+
+layout (std430, binding = 12) buffer TraversalStats
+{
+    uint stats_totals[8];       // 64 bit totals as (low, high) pairs: rays, bounces, node visits, triangle intersections
+    uint stats_traced_pixels;
+    uint stats_padding[3];
+    uint stats_cost_histogram[STATS_HISTOGRAM_BINS]; // traced pixels per log2 bin of node visits + triangle intersections
+};
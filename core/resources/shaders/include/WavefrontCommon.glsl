@@ -0,0 +1,61 @@
+/**
+ * Declarations shared by the wavefront path tracing passes (wavefront/*.comp)
+ * - every pixel owns one PathState, the passes communicate only through these buffers
+ * - generate -> (extend -> shade) * bounces -> accumulate, the active paths are stored in two ray queues (ping-pong)
+ * - MUST be exactly the same as the buffer sizes allocated by the Renderer (144 bytes per path)
+ */
+
+#define WAVEFRONT_GROUP_SIZE 64
+
+/** The PathState struct stores everything a path needs between the passes.
+ * The hit_* members are written by the extend pass and consumed by the shade pass, hit_dst < 0 marks a miss.
+ */
+struct PathState
+{
+    vec3 origin;                    // offset 0   // total 12 bytes
+    uint pixel_index;               // offset 12  // total 16 bytes
+    vec3 dir;                       // offset 16  // total 28 bytes
+    uint rng_state;                 // offset 28  // total 32 bytes
+    vec3 throughput;                // offset 32  // total 44 bytes
+    uint bounce;                    // offset 44  // total 48 bytes
+    vec3 radiance;                  // offset 48  // total 60 bytes (sum over the samples of the frame)
+    uint AABB_intersect_count;      // offset 60  // total 64 bytes
+    vec3 hit_point;                 // offset 64  // total 76 bytes
+    float hit_dst;                  // offset 76  // total 80 bytes
+    vec3 hit_normal;                // offset 80  // total 92 bytes
+    uint TRI_intersect_count;       // offset 92  // total 96 bytes
+    RaytracingMaterial hit_material;// offset 96  // total 128 bytes
+    float bsdf_pdf;                 // offset 128 // total 132 bytes (of dir, 0 for the camera ray, used by NEXT_EVENT_ESTIMATION)
+    int hit_object;                 // offset 132 // total 136 bytes (HitInfo.objectIndex)
+    vec2 path_padding;              // offset 136 // total 144 bytes
+};
+
+layout (std430, binding = 7) buffer PathStates
+{
+    PathState paths[];
+};
+
+/** Two queues of path indices, queue q starts at q * (number of pixels).
+ */
+layout (std430, binding = 8) buffer RayQueues
+{
+    uint ray_queue[];
+};
+
+/** The first three members are the indirect dispatch arguments for the queue being processed.
+ */
+layout (std430, binding = 9) buffer QueueCounters
+{
+    uint num_groups_x;
+    uint num_groups_y;
+    uint num_groups_z;
+    uint queue_count[2];
+};
+
+uniform uint u_queueIndex; // the queue processed by the pass
+
+uint getPathCount()
+{
+    ivec2 dims = u_renderSize;
+    return uint(dims.x * dims.y);
+}
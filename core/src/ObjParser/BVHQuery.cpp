@@ -0,0 +1,207 @@
+#include "core/ObjParser/BVHQuery.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "core/util/Profiler.h"
+
+namespace {
+    // the slab test of RayAABBIntersection (include/RayTracingCommon.glsl)
+    bool intersectAABB(const glm::vec3& origin, const glm::vec3& inv_dir, const glm::vec3& min_vec, const glm::vec3& max_vec, float& t_min)
+    {
+        glm::vec3 t1 = (min_vec - origin) * inv_dir;
+        glm::vec3 t2 = (max_vec - origin) * inv_dir;
+        glm::vec3 t_near = glm::min(t1, t2);
+        glm::vec3 t_far = glm::max(t1, t2);
+
+        t_min = std::max(std::max(t_near.x, t_near.y), t_near.z);
+        float t_max = std::min(std::min(t_far.x, t_far.y), t_far.z);
+        return t_max >= t_min && t_max >= 0.0f;
+    }
+
+    // the back-face culled Moller-Trumbore test of RayTriangleIntersection (include/RayTracingCommon.glsl)
+    bool intersectTriangle(const Triangle& tri, const glm::vec3& origin, const glm::vec3& dir, float& t)
+    {
+        glm::vec3 E1 = tri.v2 - tri.v1;
+        glm::vec3 E2 = tri.v3 - tri.v1;
+        glm::vec3 tri_normal = glm::cross(E1, E2);
+
+        float determinant = -glm::dot(dir, tri_normal);
+        if (determinant < 1E-6f) {
+            return false;
+        }
+
+        float invdet = 1.0f / determinant;
+        glm::vec3 AO = origin - tri.v1;
+        glm::vec3 DAO = glm::cross(AO, dir);
+
+        t = glm::dot(AO, tri_normal) * invdet;
+        float u = glm::dot(E2, DAO) * invdet;
+        float v = -glm::dot(E1, DAO) * invdet;
+        return t >= 0.0f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f;
+    }
+
+    // any_hit = return on the first hit closer than max_dst (hit_dst and hit_triangle are not written)
+    template <bool any_hit>
+    bool traverse(const BVH::BVH_data& bvh, const glm::vec3& origin, const glm::vec3& dir, float max_dst,
+        float& hit_dst, int& hit_triangle, BVH::QueryCounters* counters)
+    {
+        if (bvh.BVH_size == 0) {
+            return false;
+        }
+
+        // both children of a node are pushed, at most one pending sibling per level (+ the root) is on the stack
+        thread_local std::vector<int> stack;
+        stack.clear();
+        stack.reserve(bvh.BVH_tree_depth + 2);
+        stack.push_back(0);
+
+        glm::vec3 inv_dir = 1.0f / dir;
+        float closest = max_dst;
+        bool hit = false;
+
+        while (!stack.empty())
+        {
+            const BVH::Node& node = bvh.BVH[stack.back()];
+            stack.pop_back();
+
+            float t_min;
+            if (!intersectAABB(origin, inv_dir, node.minVec, node.maxVec, t_min) || t_min > closest) {
+                continue;
+            }
+
+            if (node.child1_idx == -1 && node.child2_idx == -1)
+            {
+                for (unsigned int i = 0; i < BVH::AABB_primitives_limit; i++)
+                {
+                    int triangle_idx = node.leaf_primitive_indices[i].data;
+                    if (triangle_idx == -1) {
+                        break;
+                    }
+                    if (counters) { counters->triangle_tests++; }
+
+                    float t;
+                    if (intersectTriangle(bvh.TRIANGLES[triangle_idx], origin, dir, t) && t < closest) {
+                        if (any_hit) {
+                            return true;
+                        }
+                        closest = t;
+                        hit_triangle = triangle_idx;
+                        hit = true;
+                    }
+                }
+            }
+            else
+            {
+                if (counters) { counters->node_visits++; }
+                if (node.child1_idx != -1) { stack.push_back(node.child1_idx); }
+                if (node.child2_idx != -1) { stack.push_back(node.child2_idx); }
+            }
+        }
+
+        if (hit) {
+            hit_dst = closest;
+        }
+        return hit;
+    }
+
+    // uniformly distributed point on the triangle
+    glm::vec3 samplePoint(const Triangle& tri, float r1, float r2)
+    {
+        float su = std::sqrt(r1);
+        return tri.v1 * (1.0f - su) + tri.v2 * (su * (1.0f - r2)) + tri.v3 * (su * r2);
+    }
+
+    double msSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+bool BVH::closestHit(const BVH_data& bvh, const glm::vec3& origin, const glm::vec3& dir, float max_dst,
+    float& hit_dst, int& hit_triangle, QueryCounters* counters)
+{
+    return traverse<false>(bvh, origin, dir, max_dst, hit_dst, hit_triangle, counters);
+}
+
+bool BVH::occluded(const BVH_data& bvh, const glm::vec3& origin, const glm::vec3& dir, float max_dst, QueryCounters* counters)
+{
+    float hit_dst;
+    int hit_triangle;
+    return traverse<true>(bvh, origin, dir, max_dst, hit_dst, hit_triangle, counters);
+}
+
+BVH::QueryBenchmark BVH::benchmarkQueries(const BVH_data& bvh, unsigned int ray_count, uint32_t seed)
+{
+    PROFILE_SCOPE("BVH::benchmarkQueries");
+    QueryBenchmark result;
+    if (bvh.BVH_size == 0 || bvh.TRIANGLES_size == 0) {
+        return result;
+    }
+
+    struct VisibilityRay {
+        glm::vec3 origin;
+        glm::vec3 dir;
+        float max_dst;
+    };
+
+    // the start points are lifted off their surface like the shadow rays of the shaders (relative to the scene size)
+    const Node& root = bvh.BVH[0];
+    float offset = 1e-4f * glm::length(root.maxVec - root.minVec);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::uniform_int_distribution<unsigned int> pick_triangle(0, bvh.TRIANGLES_size - 1);
+
+    std::vector<VisibilityRay> rays;
+    rays.reserve(ray_count);
+    while (rays.size() < ray_count)
+    {
+        const Triangle& from = bvh.TRIANGLES[pick_triangle(rng)];
+        const Triangle& to = bvh.TRIANGLES[pick_triangle(rng)];
+        glm::vec3 normal = glm::cross(from.v2 - from.v1, from.v3 - from.v1);
+        if (glm::dot(normal, normal) <= 0.0f) {
+            continue; // degenerate triangle
+        }
+
+        VisibilityRay ray;
+        ray.origin = samplePoint(from, uniform(rng), uniform(rng)) + glm::normalize(normal) * offset;
+        glm::vec3 to_end = samplePoint(to, uniform(rng), uniform(rng)) - ray.origin;
+        float distance = glm::length(to_end);
+        if (distance <= offset) {
+            continue;
+        }
+        ray.dir = to_end / distance;
+        ray.max_dst = distance * (1.0f - 1e-3f); // stops short of the end point, its own surface doesn't block it
+        rays.push_back(ray);
+    }
+    result.rays = ray_count;
+
+    std::vector<char> closest_hit_occluded(ray_count);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ray_count; i++)
+    {
+        float hit_dst;
+        int hit_triangle;
+        bool hit = closestHit(bvh, rays[i].origin, rays[i].dir, std::numeric_limits<float>::max(), hit_dst, hit_triangle, &result.closest_hit_counters);
+        closest_hit_occluded[i] = hit && hit_dst < rays[i].max_dst;
+    }
+    result.closest_hit_ms = msSince(start);
+
+    std::vector<char> any_hit_occluded(ray_count);
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ray_count; i++)
+    {
+        any_hit_occluded[i] = occluded(bvh, rays[i].origin, rays[i].dir, rays[i].max_dst, &result.any_hit_counters);
+    }
+    result.any_hit_ms = msSince(start);
+
+    for (unsigned int i = 0; i < ray_count; i++)
+    {
+        result.occluded_rays += any_hit_occluded[i] ? 1 : 0;
+        result.mismatches += any_hit_occluded[i] != closest_hit_occluded[i] ? 1 : 0;
+    }
+    return result;
+}
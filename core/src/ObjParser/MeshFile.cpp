@@ -0,0 +1,156 @@
+#include "core/ObjParser/MeshFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // whether the file starts with the header of the current version (older caches get rebuilt)
+    bool isCurrentVersion(const std::string& path) {
+        MeshFile::Header header;
+        std::ifstream file(path, std::ios::binary);
+        return file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            && std::memcmp(header.magic, MeshFile::magic, sizeof(MeshFile::magic)) == 0 && header.version == MeshFile::version;
+    }
+}
+
+bool MeshFile::isMeshFile(const std::string& path)
+{
+    return std::filesystem::path(path).extension() == file_extension;
+}
+
+MeshFile::View::View(const std::string& path)
+    : m_File(std::make_unique<MappedFile>(path))
+{
+    if (!m_File->IsOpen() || m_File->Size() < sizeof(Header)) {
+        std::cerr << "MeshFile - not a valid mesh file: " << path << std::endl;
+        return;
+    }
+
+    Header header;
+    std::memcpy(&header, m_File->Data(), sizeof(Header));
+
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.file_size != m_File->Size()) {
+        std::cerr << "MeshFile - unsupported or truncated mesh file: " << path << std::endl;
+        return;
+    }
+
+    m_Triangles = static_cast<const Triangle*>(getSection(header, SectionType::TRIANGLES, sizeof(Triangle), m_TriangleCount));
+
+    if (m_Triangles == nullptr) {
+        std::cerr << "MeshFile - missing or corrupted triangle section: " << path << std::endl;
+    }
+}
+
+const void* MeshFile::View::getSection(const Header& header, SectionType type, uint32_t element_size, size_t& count) const
+{
+    count = 0;
+    for (uint32_t i = 0; i < header.section_count && i < static_cast<uint32_t>(SectionType::COUNT); i++)
+    {
+        const Section& section = header.sections[i];
+        if (section.type != static_cast<uint32_t>(type)) {
+            continue;
+        }
+
+        // the struct layout has to match the one the file was written with
+        if (section.element_size != element_size || section.offset % section_alignment != 0) {
+            return nullptr;
+        }
+        if (section.offset > m_File->Size() || section.count > (m_File->Size() - section.offset) / element_size) {
+            return nullptr;
+        }
+
+        count = static_cast<size_t>(section.count);
+        return m_File->Data() + section.offset;
+    }
+    return nullptr;
+}
+
+bool MeshFile::write(const std::string& path, const std::vector<Triangle>& triangles)
+{
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.section_count = static_cast<uint32_t>(SectionType::COUNT);
+
+    Section& triangle_section = header.sections[static_cast<size_t>(SectionType::TRIANGLES)];
+    triangle_section.type = static_cast<uint32_t>(SectionType::TRIANGLES);
+    triangle_section.element_size = sizeof(Triangle);
+    triangle_section.offset = alignUp(sizeof(Header), section_alignment);
+    triangle_section.count = triangles.size();
+
+    header.file_size = triangle_section.offset + triangle_section.count * sizeof(Triangle);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "MeshFile - could not open for writing: " << path << std::endl;
+        return false;
+    }
+
+    const char zeros[section_alignment] = {};
+    auto padTo = [&](uint64_t offset) {
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    padTo(triangle_section.offset);
+    file.write(reinterpret_cast<const char*>(triangles.data()), static_cast<std::streamsize>(triangles.size() * sizeof(Triangle)));
+
+    if (!file) {
+        std::cerr << "MeshFile - failed while writing: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::load(const std::string& path, std::vector<Triangle>& mesh, unsigned int& numTriangles)
+{
+    numTriangles = 0;
+
+    View view(path);
+    if (!view.isValid()) {
+        return;
+    }
+
+    // copied because the BVH build reorders the triangles, the mapping only saves the parse
+    mesh.insert(mesh.end(), view.triangles(), view.triangles() + view.triangleCount());
+    numTriangles = static_cast<unsigned int>(view.triangleCount());
+    std::cout << numTriangles << " triangles loaded" << std::endl;
+}
+
+bool MeshFile::convert(const std::string& source_path, const std::string& destination_path)
+{
+    std::vector<Triangle> triangles;
+    unsigned int num_triangles = 0;
+    loadMesh(source_path, triangles, num_triangles);
+
+    if (num_triangles == 0) {
+        return false;
+    }
+    return write(destination_path, triangles);
+}
+
+std::string MeshFile::getCached(const std::string& source_path)
+{
+    if (isMeshFile(source_path)) {
+        return source_path;
+    }
+
+    std::filesystem::path cached_path(source_path);
+    cached_path.replace_extension(file_extension);
+
+    std::error_code error;
+    bool up_to_date = std::filesystem::exists(cached_path, error) &&
+        std::filesystem::last_write_time(cached_path, error) >= std::filesystem::last_write_time(source_path, error) &&
+        isCurrentVersion(cached_path.string());
+
+    if (!up_to_date && !convert(source_path, cached_path.string())) {
+        return source_path;
+    }
+    return cached_path.string();
+}
@@ -0,0 +1,328 @@
+#include "core/ObjParser/NativeObjParser.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#include "core/util/MappedFile.h"
+#include "core/util/Parallel.h"
+
+namespace {
+
+    // chunks smaller than this aren't worth a thread
+    const size_t min_chunk_size = 1 << 20;
+
+    const int32_t invalid_index = -1;
+
+    struct Corner {
+        int32_t position;
+        int32_t normal;     ///< invalid_index if the face has no normal
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        size_t position_count = 0;
+        size_t normal_count = 0;
+        size_t position_base = 0;       ///< global index of the first position in this chunk
+        size_t normal_base = 0;         ///< global index of the first normal in this chunk
+
+        std::vector<Corner> corners;    ///< 3 corners per triangle
+        size_t triangle_base = 0;       ///< index of the first triangle of this chunk in the mesh
+    };
+
+    inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+    inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+    inline const char* skipBlanks(const char* p, const char* end) {
+        while (p < end && isBlank(*p)) { p++; }
+        return p;
+    }
+
+    inline const char* nextLine(const char* p, const char* end) {
+        const char* new_line = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        return new_line ? new_line + 1 : end;
+    }
+
+    enum class LineType { POSITION, NORMAL, FACE, OTHER };
+
+    // p is moved past the keyword
+    inline LineType classifyLine(const char*& p, const char* end) {
+        p = skipBlanks(p, end);
+        if (end - p >= 2 && p[0] == 'v' && isBlank(p[1])) { p += 2; return LineType::POSITION; }
+        if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) { p += 3; return LineType::NORMAL; }
+        if (end - p >= 2 && p[0] == 'f' && isBlank(p[1])) { p += 2; return LineType::FACE; }
+        return LineType::OTHER;
+    }
+
+    /**
+     * Parses a decimal float ([+-]digits[.digits][(e|E)[+-]digits]).
+     * The mantissa is accumulated as an integer and scaled once, which keeps the loop free of floating point work.
+     */
+    inline float parseFloat(const char*& p, const char* end) {
+        static const double powers_of_ten[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        p = skipBlanks(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = (*p == '-');
+            p++;
+        }
+
+        uint64_t mantissa = 0;
+        int significant_digits = 0;
+        int exponent = 0;
+        for (; p < end && isDigit(*p); p++) {
+            if (significant_digits < 18) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant_digits += (mantissa != 0);
+            }
+            else {
+                exponent++; // digits past the precision of a double only scale the value
+            }
+        }
+        if (p < end && *p == '.') {
+            for (p++; p < end && isDigit(*p); p++) {
+                if (significant_digits < 18) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    significant_digits += (mantissa != 0);
+                    exponent--;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            bool negative_exponent = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative_exponent = (*p == '-');
+                p++;
+            }
+            int explicit_exponent = 0;
+            for (; p < end && isDigit(*p); p++) {
+                explicit_exponent = std::min(explicit_exponent * 10 + (*p - '0'), 1000);
+            }
+            exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+        }
+
+        double value = static_cast<double>(mantissa);
+        while (exponent > 22) { value *= 1e22; exponent -= 22; }
+        while (exponent < -22) { value /= 1e22; exponent += 22; }
+        value = exponent >= 0 ? value * powers_of_ten[exponent] : value / powers_of_ten[-exponent];
+
+        return static_cast<float>(negative ? -value : value);
+    }
+
+    inline bool parseInt(const char*& p, const char* end, long long& value) {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = (*p == '-');
+            p++;
+        }
+        if (p >= end || !isDigit(*p)) {
+            return false;
+        }
+        value = 0;
+        for (; p < end && isDigit(*p); p++) {
+            value = value * 10 + (*p - '0');
+        }
+        if (negative) { value = -value; }
+        return true;
+    }
+
+    /**
+     * Turns an OBJ index (1 based, or negative = relative to the current end of the list) into a global 0 based index.
+     * @param current_count number of elements defined before this line (in the whole file)
+     */
+    inline int32_t resolveIndex(long long index, size_t current_count, size_t total_count) {
+        long long resolved = index > 0 ? index - 1 : static_cast<long long>(current_count) + index;
+        if (index == 0 || resolved < 0 || resolved >= static_cast<long long>(total_count)) {
+            return invalid_index;
+        }
+        return static_cast<int32_t>(resolved);
+    }
+
+    void countChunk(Chunk& chunk) {
+        for (const char* line = chunk.begin; line < chunk.end; line = nextLine(line, chunk.end)) {
+            const char* p = line;
+            LineType type = classifyLine(p, chunk.end);
+            chunk.position_count += (type == LineType::POSITION);
+            chunk.normal_count += (type == LineType::NORMAL);
+        }
+    }
+
+    void parseChunk(Chunk& chunk, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) {
+        size_t position_idx = chunk.position_base;
+        size_t normal_idx = chunk.normal_base;
+        std::vector<Corner> polygon;
+
+        for (const char* line = chunk.begin; line < chunk.end; ) {
+            const char* line_end = nextLine(line, chunk.end);
+            const char* p = line;
+
+            switch (classifyLine(p, line_end)) {
+            case LineType::POSITION: {
+                glm::vec3& position = positions[position_idx++];
+                position.x = parseFloat(p, line_end);
+                position.y = parseFloat(p, line_end);
+                position.z = parseFloat(p, line_end);
+                break;
+            }
+            case LineType::NORMAL: {
+                glm::vec3& normal = normals[normal_idx++];
+                normal.x = parseFloat(p, line_end);
+                normal.y = parseFloat(p, line_end);
+                normal.z = parseFloat(p, line_end);
+                break;
+            }
+            case LineType::FACE: {
+                polygon.clear();
+                bool valid = true;
+                for (p = skipBlanks(p, line_end); p < line_end && !std::isspace(static_cast<unsigned char>(*p)) && *p != '#'; p = skipBlanks(p, line_end)) {
+                    long long index;
+                    Corner corner = { invalid_index, invalid_index };
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    valid &= parseInt(p, line_end, index);
+                    if (valid) {
+                        corner.position = resolveIndex(index, position_idx, positions.size());
+                    }
+                    if (p < line_end && *p == '/') {
+                        p++;
+                        parseInt(p, line_end, index); // texture coordinates are not used
+                        if (p < line_end && *p == '/') {
+                            p++;
+                            if (parseInt(p, line_end, index)) {
+                                corner.normal = resolveIndex(index, normal_idx, normals.size());
+                            }
+                        }
+                    }
+                    valid &= (corner.position != invalid_index);
+                    polygon.push_back(corner);
+
+                    // skip anything unexpected up to the next blank
+                    while (p < line_end && !std::isspace(static_cast<unsigned char>(*p))) { p++; }
+                }
+
+                // fan triangulation
+                if (valid) {
+                    for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                        chunk.corners.push_back(polygon[0]);
+                        chunk.corners.push_back(polygon[i]);
+                        chunk.corners.push_back(polygon[i + 1]);
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            line = line_end;
+        }
+    }
+}
+
+bool NativeObj::isObjFile(const std::string& path)
+{
+    if (path.size() < 4) {
+        return false;
+    }
+    std::string extension = path.substr(path.size() - 4);
+    for (char& c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return extension == ".obj";
+}
+
+bool NativeObj::load(const std::string& path, std::vector<Triangle>& mesh, unsigned int& numTriangles)
+{
+    numTriangles = 0;
+
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    const char* data = file.Data();
+    const char* data_end = data + file.Size();
+
+    // line aligned chunks
+    size_t chunk_count = std::max<size_t>(1, std::min<size_t>(Parallel::workerCount() * 4, file.Size() / min_chunk_size));
+    std::vector<Chunk> chunks(chunk_count);
+    for (size_t i = 0; i < chunk_count; i++) {
+        const char* begin = data + file.Size() * i / chunk_count;
+        if (i > 0 && begin[-1] != '\n') {
+            begin = nextLine(begin, data_end);
+        }
+        chunks[i].begin = begin;
+        if (i > 0) {
+            chunks[i - 1].end = begin;
+        }
+    }
+    chunks.back().end = data_end;
+
+    // pass 1 - count the positions and normals so every chunk knows its global indices
+    Parallel::forEach(chunk_count, [&](size_t i) { countChunk(chunks[i]); });
+
+    size_t total_positions = 0;
+    size_t total_normals = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.position_base = total_positions;
+        chunk.normal_base = total_normals;
+        total_positions += chunk.position_count;
+        total_normals += chunk.normal_count;
+    }
+
+    // pass 2 - parse
+    std::vector<glm::vec3> positions(total_positions);
+    std::vector<glm::vec3> normals(total_normals);
+    Parallel::forEach(chunk_count, [&](size_t i) { parseChunk(chunks[i], positions, normals); });
+
+    size_t triangle_offset = mesh.size();
+    size_t total_triangles = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.triangle_base = triangle_offset + total_triangles;
+        total_triangles += chunk.corners.size() / 3;
+    }
+    if (total_triangles == 0) {
+        return false;
+    }
+
+    // pass 3 - merge the chunks into the mesh
+    const RaytracingMaterial material = getDefaultMaterial();
+    mesh.resize(triangle_offset + total_triangles);
+    Parallel::forEach(chunk_count, [&](size_t i) {
+        const Chunk& chunk = chunks[i];
+        for (size_t corner = 0; corner < chunk.corners.size(); corner += 3) {
+            const Corner& a = chunk.corners[corner];
+            const Corner& b = chunk.corners[corner + 1];
+            const Corner& c = chunk.corners[corner + 2];
+
+            Triangle& triangle = mesh[chunk.triangle_base + corner / 3];
+            triangle.v1 = positions[a.position];
+            triangle.v2 = positions[b.position];
+            triangle.v3 = positions[c.position];
+
+            if (a.normal != invalid_index && b.normal != invalid_index && c.normal != invalid_index) {
+                triangle.NA = normals[a.normal];
+                triangle.NB = normals[b.normal];
+                triangle.NC = normals[c.normal];
+            }
+            else {
+                glm::vec3 face_normal = glm::cross(triangle.v2 - triangle.v1, triangle.v3 - triangle.v1);
+                float length = glm::length(face_normal);
+                face_normal = length > 0.0f ? face_normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                triangle.NA = triangle.NB = triangle.NC = face_normal;
+            }
+
+            triangle.centroid = (triangle.v1 + triangle.v2 + triangle.v3) / 3.0f;
+            triangle.material = material;
+        }
+    });
+
+    numTriangles = static_cast<unsigned int>(total_triangles);
+    std::cout << numTriangles << " triangles loaded" << std::endl;
+    return true;
+}
@@ -1,8 +1,16 @@
 #include "core/ObjParser/ObjParser.h"
+#include "core/ObjParser/MeshFile.h"
+#include "core/ObjParser/NativeObjParser.h"
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "core/util/Parallel.h"
+#include "core/util/Profiler.h"
+
+#include <cmath>
+#include <mutex>
+
 // Setting up custom std::cout of the triangle
 std::ostream& operator<<(std::ostream& os, const Triangle& triangle)
 {
@@ -19,8 +27,19 @@ std::ostream& operator<<(std::ostream& os, const Triangle& triangle)
 
 void loadMesh(std::string filePath, std::vector<Triangle>& mesh, unsigned int& numTriangles)
 {
+    PROFILE_SCOPE("loadMesh");
 
     numTriangles = 0;
+
+    // native mesh files are already in the GPU layout, no need to go through assimp
+    if (MeshFile::isMeshFile(filePath)) {
+        MeshFile::load(filePath, mesh, numTriangles);
+        return;
+    }
+
+    if (NativeObj::isObjFile(filePath) && NativeObj::load(filePath, mesh, numTriangles)) {
+        return;
+    }
     
     const aiScene* scene = aiImportFile(filePath.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
 
@@ -29,9 +48,59 @@ void loadMesh(std::string filePath, std::vector<Triangle>& mesh, unsigned int& n
 		return;
 	}
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
-        const aiMesh* currentMesh = scene->mMeshes[i];
-        for (unsigned int i = 0; i < currentMesh->mNumFaces; ++i) {
+    /*
+        The conversion is done in two passes over face ranges (every mesh is split into ranges of faces):
+        1. count the triangle faces of every range, a prefix sum gives every range its first triangle in the mesh
+        2. fill the preallocated mesh, every range independently
+        Both passes run in parallel.
+    */
+    struct FaceRange {
+        unsigned int mesh_idx;
+        unsigned int first_face;
+        unsigned int end_face;
+        size_t first_triangle;  ///< index of the first triangle of this range in the mesh
+        size_t triangle_count;
+    };
+    const unsigned int faces_per_range = 1 << 16;
+
+    std::vector<FaceRange> ranges;
+    for (unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; ++mesh_idx) {
+        const unsigned int num_faces = scene->mMeshes[mesh_idx]->mNumFaces;
+        for (unsigned int first_face = 0; first_face < num_faces; first_face += faces_per_range) {
+            ranges.push_back({ mesh_idx, first_face, std::min(first_face + faces_per_range, num_faces), 0, 0 });
+        }
+    }
+
+    // the material is resolved once per mesh (for now every mesh maps to the default material)
+    std::vector<RaytracingMaterial> mesh_materials(scene->mNumMeshes, getDefaultMaterial());
+
+    // pass 1 - count the triangles
+    Parallel::forEach(ranges.size(), [&](size_t range_idx) {
+        FaceRange& range = ranges[range_idx];
+        const aiMesh* currentMesh = scene->mMeshes[range.mesh_idx];
+        for (unsigned int i = range.first_face; i < range.end_face; ++i) {
+            range.triangle_count += (currentMesh->mFaces[i].mNumIndices == 3); // non-triangle faces are skipped
+        }
+    });
+
+    size_t triangle_offset = mesh.size();
+    for (FaceRange& range : ranges) {
+        range.first_triangle = triangle_offset;
+        triangle_offset += range.triangle_count;
+    }
+    numTriangles = static_cast<unsigned int>(triangle_offset - mesh.size());
+    mesh.resize(triangle_offset);
+
+    // pass 2 - fill the triangles
+    Parallel::forEach(ranges.size(), [&](size_t range_idx) {
+        const FaceRange& range = ranges[range_idx];
+        const aiMesh* currentMesh = scene->mMeshes[range.mesh_idx];
+        const RaytracingMaterial& material = mesh_materials[range.mesh_idx];
+
+        auto toVec3 = [](const aiVector3D& vector) { return glm::vec3(vector.x, vector.y, vector.z); };
+
+        size_t triangle_idx = range.first_triangle;
+        for (unsigned int i = range.first_face; i < range.end_face; ++i) {
             const aiFace& face = currentMesh->mFaces[i];
 
             // Ensure the face is a triangle 
@@ -39,49 +108,39 @@ void loadMesh(std::string filePath, std::vector<Triangle>& mesh, unsigned int& n
                 continue; // Skip non-triangle faces
             }
 
-            Triangle triangle;
-            triangle.v1 = glm::vec3(currentMesh->mVertices[face.mIndices[0]].x,
-                                    currentMesh->mVertices[face.mIndices[0]].y,
-                                    currentMesh->mVertices[face.mIndices[0]].z);
-
-            triangle.v2 = glm::vec3(currentMesh->mVertices[face.mIndices[1]].x,
-                					currentMesh->mVertices[face.mIndices[1]].y,
-                					currentMesh->mVertices[face.mIndices[1]].z);
-
-            triangle.v3 = glm::vec3(currentMesh->mVertices[face.mIndices[2]].x,
-                					currentMesh->mVertices[face.mIndices[2]].y,
-                					currentMesh->mVertices[face.mIndices[2]].z);
-
-            triangle.NA = glm::vec3(currentMesh->mNormals[face.mIndices[0]].x,
-                                    currentMesh->mNormals[face.mIndices[0]].y,
-                                    currentMesh->mNormals[face.mIndices[0]].z);
+            Triangle& triangle = mesh[triangle_idx++];
+            triangle.v1 = toVec3(currentMesh->mVertices[face.mIndices[0]]);
+            triangle.v2 = toVec3(currentMesh->mVertices[face.mIndices[1]]);
+            triangle.v3 = toVec3(currentMesh->mVertices[face.mIndices[2]]);
 
-            triangle.NB = glm::vec3(currentMesh->mNormals[face.mIndices[1]].x,
-                					currentMesh->mNormals[face.mIndices[1]].y,
-                					currentMesh->mNormals[face.mIndices[1]].z);
-
-            triangle.NC = glm::vec3(currentMesh->mNormals[face.mIndices[2]].x,
-                					currentMesh->mNormals[face.mIndices[2]].y,
-                					currentMesh->mNormals[face.mIndices[2]].z);
+            triangle.NA = toVec3(currentMesh->mNormals[face.mIndices[0]]);
+            triangle.NB = toVec3(currentMesh->mNormals[face.mIndices[1]]);
+            triangle.NC = toVec3(currentMesh->mNormals[face.mIndices[2]]);
 
             // Calculate centroid 
             triangle.centroid = (triangle.v1 + triangle.v2 + triangle.v3) / 3.0f;
 
-
             // Set the material properties
-            //triangle.material.color = glm::vec3(144.0f/255.0f, 50.0f/255.0f, 220.0f/255.0f); // purple
-            //triangle.material.color = glm::vec3(0.1f, 0.1f, 0.1f); // black
-            triangle.material.color = glm::vec3(0.7f, 0.7f, 0.7f); // white
-            triangle.material.emissionColor = glm::vec3(0.0f, 0.0f, 0.0f);
-            triangle.material.emissionStrength = 0.0f;
-
-            mesh.push_back(triangle);
-            numTriangles++;
+            triangle.material = material;
         }
-    }
+    });
+
+    aiReleaseImport(scene);
     std::cout << numTriangles << " triangles loaded" << std::endl;
 }
 
+RaytracingMaterial getDefaultMaterial()
+{
+    RaytracingMaterial material;
+    //material.color = glm::vec3(144.0f/255.0f, 50.0f/255.0f, 220.0f/255.0f); // purple
+    //material.color = glm::vec3(0.1f, 0.1f, 0.1f); // black
+    material.color = glm::vec3(0.7f, 0.7f, 0.7f); // white
+    material.emissionColor = glm::vec3(0.0f, 0.0f, 0.0f);
+    material.emissionStrength = 0.0f;
+    material.std140padding = 0.0f;
+    return material;
+}
+
 // Constructor for the BVH Node
 BVH::Node::Node(glm::vec3 minVec, glm::vec3 maxVec)
     : minVec(minVec), maxVec(maxVec), child1_idx(-1), child2_idx(-1)
@@ -152,7 +211,6 @@ BVH::Node BVH::init(const std::vector<unsigned int>& triangle_indices, const std
 }
 
 BVH::Partition_output BVH::PartitionNode(const BVH::Node parent_node, std::vector<unsigned int>& triangle_indices, const std::vector<Triangle>& triangles, const Heuristic& heuristic) {
-
     if (heuristic == BVH::Heuristic::SURFACE_AREA_HEURISTIC) {
 		return BVH::surface_area_heuristic(parent_node, triangle_indices, triangles, false);
 	}
@@ -401,12 +459,53 @@ BVH::Partition_output BVH::surface_area_heuristic(const BVH::Node parent_node, s
     return output;
 }
 
-BVH::BVH_data BVH::construct(std::string path, const Heuristic heuristic) {
+BVH::BVH_data BVH::construct(std::string path, const Heuristic heuristic, const ProgressCallback& progress_callback) {
+    PROFILE_SCOPE("BVH::construct");
+    auto reportProgress = [&](BuildStage stage, float stage_progress) {
+        if (progress_callback) {
+            progress_callback(stage, stage_progress);
+        }
+    };
+
     // loading mesh
+    reportProgress(BuildStage::LOADING_MESH, 0.0f);
     std::vector<Triangle> triangles;
     unsigned int num_triangles = 0;
     loadMesh(path, triangles, num_triangles);
 
+    return BVH::build(std::move(triangles), heuristic, progress_callback);
+}
+
+BVH::BVH_data BVH::build(std::vector<Triangle> triangles, const Heuristic heuristic, const ProgressCallback& progress_callback) {
+    PROFILE_SCOPE("BVH::build");
+    auto reportProgress = [&](BuildStage stage, float stage_progress) {
+        if (progress_callback) {
+            progress_callback(stage, stage_progress);
+        }
+    };
+
+    if (triangles.empty()) {
+        reportProgress(BuildStage::DONE, 1.0f);
+        return BVH_data();
+    }
+    reportProgress(BuildStage::BUILDING_BVH, 0.0f);
+
+    /*
+        The progress of the build is estimated from the partitioning work done so far.
+        Every level of the tree partitions all triangles once, so the whole build partitions
+        roughly num_triangles * log2(num_triangles / AABB_primitives_limit) triangle indices.
+    */
+    const double expected_work = double(triangles.size()) * std::max(1.0, std::log2(double(triangles.size()) / AABB_primitives_limit));
+    const double report_step = expected_work / 200.0;
+    double work_done = 0.0;
+    double last_reported_work = 0.0;
+    auto nodePartitioned = [&](size_t node_triangle_count) {
+        work_done += double(node_triangle_count);
+        if (work_done - last_reported_work >= report_step) {
+            last_reported_work = work_done;
+            reportProgress(BuildStage::BUILDING_BVH, float(std::min(work_done / expected_work, 0.99)));
+        }
+    };
 
     std::vector<unsigned int> triangle_indices;
     for (unsigned int i = 0; i < triangles.size(); i++) {
@@ -429,6 +528,7 @@ BVH::BVH_data BVH::construct(std::string path, const Heuristic heuristic) {
         std::vector<unsigned int> current_tri_idxs = index_queue.front();
         index_queue.pop();
         BVH::Partition_output output = PartitionNode(BVH[current_node_idx], current_tri_idxs, triangles, heuristic);
+        nodePartitioned(current_tri_idxs.size());
         unsigned int BVH_len = BVH.size();
 
         Node Lnode(output.LAABBmin, output.LAABBmax);
@@ -470,14 +570,188 @@ BVH::BVH_data BVH::construct(std::string path, const Heuristic heuristic) {
 
     BVH_data bvh_data;
 
-    bvh_data.BVH = BVH;
     bvh_data.BVH_size = BVH.size();
-    bvh_data.TRIANGLES = triangles;
-    bvh_data.TRIANGLES_size = num_triangles;
+    bvh_data.TRIANGLES_size = triangles.size();
     bvh_data.BVH_tree_depth = BVH::getBVHTreeDepth(BVH, BVH[0], 0);
+    bvh_data.BVH = std::move(BVH);
+    bvh_data.TRIANGLES = std::move(triangles);
+
+    reportProgress(BuildStage::DONE, 1.0f);
     return  bvh_data;
 }
 
+void BVH::transformTriangles(std::vector<Triangle>& triangles, const glm::mat4& transform)
+{
+    PROFILE_SCOPE("BVH::transformTriangles");
+    const glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+    Parallel::forRanges(triangles.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Triangle& triangle = triangles[i];
+            triangle.v1 = glm::vec3(transform * glm::vec4(triangle.v1, 1.0f));
+            triangle.v2 = glm::vec3(transform * glm::vec4(triangle.v2, 1.0f));
+            triangle.v3 = glm::vec3(transform * glm::vec4(triangle.v3, 1.0f));
+
+            triangle.NA = glm::normalize(normal_matrix * triangle.NA);
+            triangle.NB = glm::normalize(normal_matrix * triangle.NB);
+            triangle.NC = glm::normalize(normal_matrix * triangle.NC);
+
+            triangle.centroid = (triangle.v1 + triangle.v2 + triangle.v3) / 3.0f;
+        }
+    });
+}
+
+BVH::BVH_data BVH::constructScene(const std::vector<ModelInstance>& models, const Heuristic heuristic, const ProgressCallback& progress_callback) {
+    PROFILE_SCOPE("BVH::constructScene");
+    // the progress of every model, combined into a single report
+    std::mutex progress_mutex;
+    std::vector<float> model_progress(models.size(), 0.0f);
+    std::vector<bool> model_building(models.size(), false);
+    auto reportModelProgress = [&](size_t model_idx, BuildStage stage, float stage_progress) {
+        if (!progress_callback) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        if (stage != BuildStage::LOADING_MESH) {
+            model_building[model_idx] = true;
+            model_progress[model_idx] = stage == BuildStage::DONE ? 1.0f : stage_progress;
+        }
+
+        // the scene is loading until every model is building its BVH
+        size_t building_count = std::count(model_building.begin(), model_building.end(), true);
+        if (building_count < models.size()) {
+            progress_callback(BuildStage::LOADING_MESH, float(building_count) / float(models.size()));
+        }
+        else {
+            float sum = 0.0f;
+            for (float progress : model_progress) { sum += progress; }
+            progress_callback(BuildStage::BUILDING_BVH, sum / float(models.size()));
+        }
+    };
+
+    // one task per model: load, transform, build
+    std::vector<BVH_data> parts(models.size());
+    Parallel::forEach(models.size(), [&](size_t model_idx) {
+        const ModelInstance& model = models[model_idx];
+
+        std::vector<Triangle> triangles;
+        unsigned int num_triangles = 0;
+        loadMesh(model.path, triangles, num_triangles);
+        if (model.transform != glm::mat4(1.0f)) {
+            BVH::transformTriangles(triangles, model.transform);
+        }
+
+        parts[model_idx] = BVH::build(std::move(triangles), heuristic, [&](BuildStage stage, float stage_progress) {
+            reportModelProgress(model_idx, stage, stage_progress);
+        });
+    });
+
+    BVH_data scene = BVH::merge(parts);
+    if (progress_callback) {
+        progress_callback(BuildStage::DONE, 1.0f);
+    }
+    return scene;
+}
+
+BVH::BVH_data BVH::merge(std::vector<BVH::BVH_data>& parts) {
+    PROFILE_SCOPE("BVH::merge");
+    // models which failed to load are dropped
+    parts.erase(std::remove_if(parts.begin(), parts.end(), [](const BVH_data& part) { return part.BVH_size == 0; }), parts.end());
+
+    if (parts.empty()) {
+        return BVH_data();
+    }
+    if (parts.size() == 1) {
+        return std::move(parts[0]);
+    }
+
+    // a binary tree over N parts has N - 1 internal nodes, they are placed in front of the parts
+    const unsigned int top_level_size = parts.size() - 1;
+
+    std::vector<unsigned int> node_offsets(parts.size());
+    std::vector<unsigned int> triangle_offsets(parts.size());
+    unsigned int total_nodes = top_level_size;
+    unsigned int total_triangles = 0;
+    for (size_t i = 0; i < parts.size(); i++) {
+        node_offsets[i] = total_nodes;
+        triangle_offsets[i] = total_triangles;
+        total_nodes += parts[i].BVH_size;
+        total_triangles += parts[i].TRIANGLES_size;
+    }
+
+    BVH_data merged;
+    merged.BVH.resize(total_nodes);
+    merged.TRIANGLES.resize(total_triangles);
+
+    // append the parts with their child and primitive indices offset
+    Parallel::forEach(parts.size(), [&](size_t part_idx) {
+        BVH_data& part = parts[part_idx];
+        std::copy(part.TRIANGLES.begin(), part.TRIANGLES.end(), merged.TRIANGLES.begin() + triangle_offsets[part_idx]);
+
+        for (unsigned int i = 0; i < part.BVH_size; i++) {
+            Node node = part.BVH[i];
+            if (node.child1_idx != -1) { node.child1_idx += node_offsets[part_idx]; }
+            if (node.child2_idx != -1) { node.child2_idx += node_offsets[part_idx]; }
+            for (unsigned int j = 0; j < AABB_primitives_limit; j++) {
+                if (node.leaf_primitive_indices[j].data != -1) {
+                    node.leaf_primitive_indices[j].data += triangle_offsets[part_idx];
+                }
+            }
+            merged.BVH[node_offsets[part_idx] + i] = node;
+        }
+        part = BVH_data(); // release the memory early
+    });
+
+    // top-level tree - median split of the part roots along the longest axis of their centroids
+    std::vector<unsigned int> part_indices(node_offsets.size());
+    for (unsigned int i = 0; i < part_indices.size(); i++) {
+        part_indices[i] = i;
+    }
+    unsigned int next_top_level_node = 0;
+
+    std::function<int(unsigned int, unsigned int)> buildTopLevel = [&](unsigned int begin, unsigned int end) -> int {
+        if (end - begin == 1) {
+            return node_offsets[part_indices[begin]]; // the root of a part
+        }
+
+        glm::vec3 centroid_min(std::numeric_limits<float>::infinity());
+        glm::vec3 centroid_max(-std::numeric_limits<float>::infinity());
+        for (unsigned int i = begin; i < end; i++) {
+            const Node& part_root = merged.BVH[node_offsets[part_indices[i]]];
+            glm::vec3 centroid = (part_root.minVec + part_root.maxVec) * 0.5f;
+            centroid_min = minCorner(centroid_min, centroid);
+            centroid_max = maxCorner(centroid_max, centroid);
+        }
+        glm::vec3 extent = centroid_max - centroid_min;
+        int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        unsigned int middle = begin + (end - begin) / 2;
+        std::nth_element(part_indices.begin() + begin, part_indices.begin() + middle, part_indices.begin() + end, [&](unsigned int a, unsigned int b) {
+            const Node& root_a = merged.BVH[node_offsets[a]];
+            const Node& root_b = merged.BVH[node_offsets[b]];
+            return (root_a.minVec[axis] + root_a.maxVec[axis]) < (root_b.minVec[axis] + root_b.maxVec[axis]);
+        });
+
+        unsigned int node_idx = next_top_level_node++;
+        int child1_idx = buildTopLevel(begin, middle);
+        int child2_idx = buildTopLevel(middle, end);
+
+        const Node& child1 = merged.BVH[child1_idx];
+        const Node& child2 = merged.BVH[child2_idx];
+        Node node(minCorner(child1.minVec, child2.minVec), maxCorner(child1.maxVec, child2.maxVec));
+        node.child1_idx = child1_idx;
+        node.child2_idx = child2_idx;
+        merged.BVH[node_idx] = node;
+        return node_idx;
+    };
+    buildTopLevel(0, part_indices.size());
+
+    merged.BVH_size = merged.BVH.size();
+    merged.TRIANGLES_size = merged.TRIANGLES.size();
+    merged.BVH_tree_depth = BVH::getBVHTreeDepth(merged.BVH, merged.BVH[0], 0);
+    return merged;
+}
+
 /**
 * @brief Get the maximum height of the BVH
 * @param BVH - the BVH
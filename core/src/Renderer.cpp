@@ -1,19 +1,116 @@
 #include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <iterator>
+#include <cstring>
 
 #include "core/Renderer.h"
+#include "core/util/Profiler.h"
 
 struct SceneData;
 
 Renderer::Renderer(SceneData& scene, BVH::BVH_data BVH_of_mesh)
 	: m_Scene(scene),
 
-	computeRtxShader(nullptr),
+	rtx_parameters_UBO_ring(nullptr),
+	postProcessing_parameters_UBO_ring(nullptr),
+
+	pixelData_readback(nullptr),
+	m_ShowPixelData(true),
+	m_PixelDataReadback(true),
+
+	rayCounter_SSBO_ID(0),
+	rayCounter_readback(nullptr),
+	m_RaysPerFrame(0),
+
+	m_TracingMode(TracingMode::MEGAKERNEL),
+
+	pathStates_SSBO_ID(0),
+	rayQueues_SSBO_ID(0),
+	queueCounters_SSBO_ID(0),
+	m_WavefrontPathCount(0),
+
+	workCounter_SSBO_ID(0),
+	m_PersistentWorkGroups(1024),
+	m_SubgroupOps(false),
+
+	m_TiledRendering(false),
+	m_FrameBudgetMs(12.0f),
+	m_NextTile(0),
+	m_TilesPerFrame(0),
+	m_ResetPass(true),
+	m_ResetPassFirstTile(0),
+	m_MsPerPixel(-1.0),
+	tileTimer(nullptr),
+
+	m_AdaptiveSampling(false),
+	m_ErrorThreshold(0.01f),
+	m_MinAccumulatedFrames(8),
+	activePixels_SSBO_ID(0),
+	activePixelCount_readback(nullptr),
+	m_ActivePixelCount(0),
+
+	m_DynamicResolution(false),
+	m_TargetFrameMs(16.0f),
+	m_ResolutionScale(1.0f),
+	m_RenderSize(0, 0),
+	m_FrameMsPerPixel(-1.0),
+	frameTimer(nullptr),
+
+	m_RenderGraph(&m_Profiler),
+
+	m_TraversalStats(false),
+	traversalStats_SSBO_ID(0),
+	traversalStats_readback(nullptr),
+	statsReduceShader(nullptr),
+
+	m_Denoiser(false),
+	featureTexture(nullptr),
+	albedoTexture(nullptr),
+	denoiseShader(nullptr),
+
+	m_TemporalReprojection(false),
+	m_MaxHistoryFrames(32),
+	historyTexture(nullptr),
+	depthTexture(nullptr),
+	historyDepthTexture(nullptr),
+	m_FrameIndex(0),
+	m_HasPreviousCamera(false),
+	m_PreviousRenderSize(0, 0),
+
+	m_NextEventEstimation(false),
+	lights_SSBO_ID(0),
+	m_LightList(4, 0u),
+	m_LightsDirty(true),
+	m_LightsUploadPending(false),
+
+	m_RussianRoulette(true),
+	m_RouletteMinBounce(3),
+	m_ThroughputCutoff(1e-4f),
+
 	computeRtxTexture(nullptr),
+	computeRtxShader(nullptr),
+
+	wavefrontGenerateShader(nullptr),
+	wavefrontExtendShader(nullptr),
+	wavefrontShadeShader(nullptr),
+	wavefrontAccumulateShader(nullptr),
+	wavefrontDispatchArgsShader(nullptr),
+
+	computeRtxPersistentShader(nullptr),
+
+	varianceTexture(nullptr),
+	adaptiveAllocateShader(nullptr),
+	computeRtxAdaptiveShader(nullptr),
 
-	computePostProcShader(nullptr),
 	computePostProcTexture(nullptr),
+	computePostProcShader(nullptr),
 
-	BVH_of_mesh(BVH_of_mesh)
+	BVH_of_mesh(BVH_of_mesh),
+	// the slab test hits this box from everywhere, it is harmless because it is a leaf without primitives (-1 indices),
+	// while there is no mesh the shaders don't traverse it at all (HAS_MESH)
+	m_EmptyBVHRoot(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()))
 {
 	initComputeRtxStage();
 	initComputePostProcStage();
@@ -24,201 +121,898 @@ Renderer::~Renderer()
 	delete computeRtxShader;
 	delete computeRtxTexture;
 
+	delete wavefrontGenerateShader;
+	delete wavefrontExtendShader;
+	delete wavefrontShadeShader;
+	delete wavefrontAccumulateShader;
+	delete wavefrontDispatchArgsShader;
+
+	delete computeRtxPersistentShader;
+
+	delete varianceTexture;
+	delete adaptiveAllocateShader;
+	delete computeRtxAdaptiveShader;
+
 	delete computePostProcShader;
 	delete computePostProcTexture;
 
-	glDeleteBuffers(1, &rtx_parameters_UBO_ID);
-	glDeleteBuffers(1, &postProcessing_parameters_UBO_ID);
-	glDeleteBuffers(1, &sphereBuffer_UBO_ID);
+	delete rtx_parameters_UBO_ring;
+	delete postProcessing_parameters_UBO_ring;
+	delete pixelData_readback;
+	delete rayCounter_readback;
+	delete tileTimer;
+	delete activePixelCount_readback;
+	delete frameTimer;
+	delete traversalStats_readback;
+	delete statsReduceShader;
+	delete featureTexture;
+	delete albedoTexture;
+	delete denoiseShader;
+	delete historyTexture;
+	delete depthTexture;
+	delete historyDepthTexture;
+
+	glDeleteBuffers(1, &pixelData_SSBO_ID);
+	glDeleteBuffers(1, &rayCounter_SSBO_ID);
+	glDeleteBuffers(1, &pathStates_SSBO_ID);
+	glDeleteBuffers(1, &rayQueues_SSBO_ID);
+	glDeleteBuffers(1, &queueCounters_SSBO_ID);
+	glDeleteBuffers(1, &workCounter_SSBO_ID);
+	glDeleteBuffers(1, &activePixels_SSBO_ID);
+	glDeleteBuffers(1, &traversalStats_SSBO_ID);
+	glDeleteBuffers(1, &lights_SSBO_ID);
 }
 
 void Renderer::setViewportSize(glm::vec2 viewportSize)
 {
 	GLCall(glViewport(0, 0, viewportSize.x, viewportSize.y));
 	m_ViewportSize = viewportSize;
+	m_RenderSize = glm::ivec2(viewportSize);
+	m_ResolutionScale = 1.0f;
 
 	delete computePostProcTexture;
 	computePostProcTexture = new ComputeTexture(viewportSize.x, viewportSize.y, 1);
 
 	delete computeRtxTexture;
 	computeRtxTexture = new ComputeTexture(viewportSize.x, viewportSize.y, 0);
+	// the alpha channel counts the accumulated frames of every pixel, a new texture starts from zero
+	GLCall(glClearTexImage(computeRtxTexture->ID(), 0, GL_RGBA, GL_FLOAT, nullptr));
+
+	delete varianceTexture;
+	varianceTexture = new ComputeTexture(viewportSize.x, viewportSize.y, 2);
+	GLCall(glClearTexImage(varianceTexture->ID(), 0, GL_RGBA, GL_FLOAT, nullptr));
+	configure_ActivePixels_SSBO_block();
+
+	m_ResetPass = true;
+	m_NextTile = 0;
+	m_ResetPassFirstTile = 0;
+}
+
+
+void Renderer::setMeshData(BVH::BVH_data BVH_of_mesh)
+{
+	this->BVH_of_mesh = std::move(BVH_of_mesh);
+	set_scene_resource_sources();
 }
 
+// binding points 1 (spheres), 3 (triangles) and 4 (BVH)
+void Renderer::set_scene_resource_sources()
+{
+	m_Resources.SetSource(GPUResourceManager::Resource::SPHERES, m_Scene.sceneObjects, m_Scene.size);
+	m_Resources.SetSource(GPUResourceManager::Resource::MESH, BVH_of_mesh.TRIANGLES.data(), sizeof(Triangle) * BVH_of_mesh.TRIANGLES_size);
+	m_LightsDirty = true;
+
+	if (BVH_of_mesh.BVH_size == 0) {
+		m_Resources.SetSource(GPUResourceManager::Resource::BVH, &m_EmptyBVHRoot, sizeof(BVH::Node));
+	}
+	else {
+		m_Resources.SetSource(GPUResourceManager::Resource::BVH, BVH_of_mesh.BVH.data(), sizeof(BVH::Node) * BVH_of_mesh.BVH_size);
+	}
+}
 
 void Renderer::initComputeRtxStage()
 {	
 	// we would typically set the texture here but we dont know the texture size yet so we do it in setSize
 	//computeRtxUBO = new UniformBuffer(sizeof(ComputeRtxUniforms), 0);
-	computeRtxShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputeRayTracing.comp");
+	m_SubgroupOps = query_subgroup_ops();
+	m_RtxShaderDefines = get_rtx_shader_defines();
+	computeRtxShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputeRayTracing.comp", m_RtxShaderDefines);
 	computeRtxShader->Bind();
 	configure_rtx_parameters_UBO_block();
-	configure_sphereBuffer_UBO_block();
-	configure_TrisMesh_SSBO_block();
-	configure_BVH_SSBO_block();
 	configure_PixelData_SSBO_block();
-	
-	update_sphereBuffer_UBO_block(); // only updated once in the beginning of the scene (assuming the scene is static)
-	update_BVH_SSBO_block();
+	configure_RayCounter_SSBO_block();
+
+	wavefrontGenerateShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/wavefront/Generate.comp", m_RtxShaderDefines);
+	wavefrontExtendShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/wavefront/Extend.comp", m_RtxShaderDefines);
+	wavefrontShadeShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/wavefront/Shade.comp", m_RtxShaderDefines);
+	wavefrontAccumulateShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/wavefront/Accumulate.comp", m_RtxShaderDefines);
+	wavefrontDispatchArgsShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/wavefront/DispatchArgs.comp", m_RtxShaderDefines);
+
+	computeRtxPersistentShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputeRayTracingPersistent.comp", m_RtxShaderDefines);
+	configure_WorkCounter_SSBO_block();
+
+	tileTimer = new GPUTimer();
+	frameTimer = new GPUTimer();
+
+	adaptiveAllocateShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/adaptive/Allocate.comp", m_RtxShaderDefines);
+	computeRtxAdaptiveShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputeRayTracingAdaptive.comp", m_RtxShaderDefines);
+	activePixelCount_readback = new AsyncReadbackBuffer(sizeof(unsigned int));
+
+	statsReduceShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/stats/Reduce.comp");
+	configure_TraversalStats_SSBO_block();
+	configure_Lights_SSBO_block();
+
+	set_scene_resource_sources(); // uploaded on the first frame, afterwards only when a new mesh is swapped in
 }
 
-void Renderer::BeginComputeRtxStage()
+ShaderDefines Renderer::get_rtx_shader_defines() const
 {
-	computeRtxShader->Bind();
+	bool heatmap = rtx_uniform_parameters.display_BVH != 0;
+
+	ShaderDefines defines;
+	// the size of the sphere array (GLSL arrays can't be empty) and the number of spheres the loops actually test
+	defines["NUM_SPHERES"] = std::to_string(std::max(m_Scene.numberOfObjects, 1));
+	defines["SPHERE_COUNT"] = std::to_string(m_Scene.numberOfObjects);
+	// the traversal pushes both children of a node, at most one pending sibling per level (+ the root) is on the stack
+	defines["MAX_STACK_SIZE"] = std::to_string(BVH_of_mesh.BVH_tree_depth + 2);
+	defines["AABB_primitives_limit"] = std::to_string(BVH::AABB_primitives_limit);
+	defines["HAS_MESH"] = hasMesh() ? "1" : "0";
+	defines["SUBGROUP_OPS"] = m_SubgroupOps ? "1" : "0";
+	defines["DISPLAY_BVH"] = heatmap ? "1" : "0";
+	// the intersection counters are only read by the heatmap, the pixel info and the stats, the production variant drops them
+	defines["DEBUG_COUNTERS"] = heatmap || m_ShowPixelData || m_TraversalStats ? "1" : "0";
+	defines["TRAVERSAL_STATS"] = m_TraversalStats ? "1" : "0";
+	defines["DENOISER_FEATURES"] = is_denoising() ? "1" : "0";
+	defines["TEMPORAL_REPROJECTION"] = is_reprojecting_enabled() ? "1" : "0";
+	defines["NEXT_EVENT_ESTIMATION"] = is_sampling_lights() ? "1" : "0";
+	return defines;
+}
+
+void Renderer::update_rtx_shader_variants()
+{
+	ShaderDefines defines = get_rtx_shader_defines();
+	if (defines == m_RtxShaderDefines) {
+		return;
+	}
+	m_RtxShaderDefines = defines;
+
+	ComputeShader* rtx_shaders[] = {
+		computeRtxShader,
+		wavefrontGenerateShader, wavefrontExtendShader, wavefrontShadeShader, wavefrontAccumulateShader, wavefrontDispatchArgsShader,
+		computeRtxPersistentShader,
+		adaptiveAllocateShader, computeRtxAdaptiveShader
+	};
+	for (ComputeShader* shader : rtx_shaders) {
+		shader->SetDefines(m_RtxShaderDefines);
+	}
+}
+
+/**
+* The frame as a render graph: uploads -> rtx -> stats reduction, readbacks and post processing.
+* The CPU side state (render size, shader variants, wavefront buffers) is updated before the passes are added,
+* the passes only record GL commands. Among the passes after the rtx pass the graph runs the ones which need
+* no barrier first (the post processing shares the image barrier of the stats reduction).
+*/
+ComputeTexture* Renderer::RenderFrame()
+{
+	PROFILE_SCOPE("Renderer::RenderFrame");
+	using Access = RenderGraph::Access;
+	bool adaptive = m_AdaptiveSampling && m_TracingMode == TracingMode::MEGAKERNEL;
+	bool tiled = !adaptive && m_TiledRendering && m_TracingMode == TracingMode::MEGAKERNEL;
+
+	// the application sets WasInput to reset the accumulation, the stored pixels are overwritten until every pixel was traced again
+	bool is_moving = rtx_uniform_parameters.WasInput;
+	if (is_moving) {
+		m_ResetPass = true;
+		m_ResetPassFirstTile = m_NextTile;
+	}
+	update_render_size(is_moving, !tiled);
+	update_light_list(); // before the shader variants, a scene without lights keeps the variant without light sampling
+	update_rtx_shader_variants();
+	update_denoiser_features();
+	update_reprojection_textures();
+	// the tiles pass the reset per dispatch (u_tileWasInput), the reset pass may end within the frame
+	rtx_uniform_parameters.WasInput = m_ResetPass && !tiled;
+	rtx_uniform_parameters.renderSize = m_RenderSize;
+	rtx_uniform_parameters.frameIndex = m_FrameIndex++;
+	rtx_uniform_parameters.russianRoulette = m_RussianRoulette ? 1 : 0;
+	rtx_uniform_parameters.rouletteMinBounce = m_RouletteMinBounce;
+	rtx_uniform_parameters.throughputCutoff = m_ThroughputCutoff;
+
+	// only a camera move keeps the history (other input, like a material change, still restarts the accumulation),
+	// the depths of the previous frame have to cover the whole image at the current render size
+	bool camera_moved = rtx_uniform_parameters.CameraPos != rtx_uniform_parameters.PrevCameraPos
+		|| rtx_uniform_parameters.ModelMatrix != rtx_uniform_parameters.PrevModelMatrix
+		|| rtx_uniform_parameters.FocalLength != rtx_uniform_parameters.PrevFocalLength;
+	bool full_frame = !adaptive && !tiled;
+	bool reproject = is_moving && camera_moved && full_frame && is_reprojecting_enabled() && m_HasPreviousCamera && m_PreviousRenderSize == m_RenderSize;
+	rtx_uniform_parameters.reprojectHistory = reproject ? m_MaxHistoryFrames : 0;
+	postProcessing_uniform_parameters.renderSize = m_RenderSize;
+
+	size_t path_count = (size_t)m_ViewportSize.x * (size_t)m_ViewportSize.y;
+	if (m_TracingMode == TracingMode::WAVEFRONT && path_count != m_WavefrontPathCount) {
+		m_WavefrontPathCount = path_count;
+		configure_Wavefront_SSBO_blocks();
+	}
+
+	RenderGraph::Handle spheres = m_RenderGraph.ImportBuffer(m_Resources.Get(GPUResourceManager::Resource::SPHERES).ID());
+	RenderGraph::Handle mesh = m_RenderGraph.ImportBuffer(m_Resources.Get(GPUResourceManager::Resource::MESH).ID());
+	RenderGraph::Handle bvh = m_RenderGraph.ImportBuffer(m_Resources.Get(GPUResourceManager::Resource::BVH).ID());
+	RenderGraph::Handle lights = m_RenderGraph.ImportBuffer(lights_SSBO_ID);
+	RenderGraph::Handle rtx_texture = m_RenderGraph.ImportTexture(computeRtxTexture->ID());
+	RenderGraph::Handle variance_texture = m_RenderGraph.ImportTexture(varianceTexture->ID());
+	RenderGraph::Handle post_texture = m_RenderGraph.ImportTexture(computePostProcTexture->ID());
+	RenderGraph::Handle ray_counter = m_RenderGraph.ImportBuffer(rayCounter_SSBO_ID);
+	RenderGraph::Handle pixel_data = m_RenderGraph.ImportBuffer(pixelData_SSBO_ID);
+	RenderGraph::Handle stats_totals = m_RenderGraph.ImportBuffer(traversalStats_SSBO_ID);
+	RenderGraph::Handle stats_texture = 0;
+	if (m_TraversalStats) {
+		stats_texture = m_RenderGraph.CreateTransientTexture(m_ViewportSize.x, m_ViewportSize.y);
+	}
+
+	m_RenderGraph.AddPass("Uploads", [this]() {
+		update_rtx_parameters_UBO_block();
+		m_Resources.Flush();
+		upload_Lights_SSBO_block();
+	})
+		.Write(spheres, Access::TRANSFER)
+		.Write(mesh, Access::TRANSFER)
+		.Write(bvh, Access::TRANSFER)
+		.Write(lights, Access::TRANSFER);
+
+	RenderGraph::Pass& rtx = m_RenderGraph.AddPass("RTX", [this, adaptive, tiled, reproject, stats_texture]() { renderRtx(adaptive, tiled, reproject, stats_texture); })
+		.Read(spheres, Access::UNIFORM)
+		.Read(mesh, Access::STORAGE)
+		.Read(bvh, Access::STORAGE)
+		.Read(lights, Access::STORAGE)
+		.Write(rtx_texture, Access::IMAGE, 0)
+		.Write(variance_texture, Access::IMAGE, 2)
+		.Write(ray_counter, Access::TRANSFER)
+		.Write(ray_counter, Access::STORAGE)
+		.Write(pixel_data, Access::STORAGE);
+	if (m_TraversalStats) {
+		rtx.Write(stats_texture, Access::TRANSFER).Write(stats_texture, Access::IMAGE, 3);
+	}
+	RenderGraph::Handle features = 0, albedo = 0;
+	if (is_denoising()) {
+		features = m_RenderGraph.ImportTexture(featureTexture->ID());
+		albedo = m_RenderGraph.ImportTexture(albedoTexture->ID());
+		rtx.Write(features, Access::IMAGE, 4).Write(albedo, Access::IMAGE, 5);
+	}
+	if (is_reprojecting_enabled()) {
+		RenderGraph::Handle depth = m_RenderGraph.ImportTexture(depthTexture->ID());
+		rtx.Write(depth, Access::IMAGE, 1);
+		if (reproject) { // the history is copied at the start of the pass
+			RenderGraph::Handle history = m_RenderGraph.ImportTexture(historyTexture->ID());
+			RenderGraph::Handle history_depth = m_RenderGraph.ImportTexture(historyDepthTexture->ID());
+			rtx.Read(rtx_texture, Access::TRANSFER).Read(depth, Access::TRANSFER)
+				.Write(history, Access::TRANSFER).Read(history, Access::IMAGE, 6)
+				.Write(history_depth, Access::TRANSFER).Read(history_depth, Access::IMAGE, 7);
+		}
+	}
+	switch (m_TracingMode) {
+	case TracingMode::MEGAKERNEL:
+		if (adaptive) {
+			RenderGraph::Handle active_pixels = m_RenderGraph.ImportBuffer(activePixels_SSBO_ID);
+			rtx.Write(active_pixels, Access::TRANSFER).Write(active_pixels, Access::STORAGE).Read(active_pixels, Access::INDIRECT);
+		}
+		break;
+	case TracingMode::WAVEFRONT: {
+		RenderGraph::Handle queue_counters = m_RenderGraph.ImportBuffer(queueCounters_SSBO_ID);
+		rtx.Write(m_RenderGraph.ImportBuffer(pathStates_SSBO_ID), Access::STORAGE)
+			.Write(m_RenderGraph.ImportBuffer(rayQueues_SSBO_ID), Access::STORAGE)
+			.Write(queue_counters, Access::TRANSFER).Write(queue_counters, Access::STORAGE).Read(queue_counters, Access::INDIRECT);
+		break;
+	}
+	case TracingMode::PERSISTENT_THREADS: {
+		RenderGraph::Handle work_counter = m_RenderGraph.ImportBuffer(workCounter_SSBO_ID);
+		rtx.Write(work_counter, Access::TRANSFER).Write(work_counter, Access::STORAGE);
+		break;
+	}
+	}
+
+	if (m_TraversalStats) {
+		m_RenderGraph.AddPass("Stats", [this]() { reduce_traversal_stats(); })
+			.Read(stats_texture, Access::IMAGE, 3)
+			.Write(stats_totals, Access::TRANSFER)
+			.Write(stats_totals, Access::STORAGE);
+	}
+
+	RenderGraph::Pass& readback = m_RenderGraph.AddPass("Readback", [this]() {
+		read_RayCounter_SSBO_block();
+		read_PixelData_SSBO_block();
+		read_TraversalStats_SSBO_block();
+	})
+		.Read(ray_counter, Access::TRANSFER);
+	if (m_PixelDataReadback) {
+		readback.Read(pixel_data, Access::TRANSFER);
+	}
+	if (m_TraversalStats) {
+		readback.Read(stats_totals, Access::TRANSFER);
+	}
+
+	// every iteration reads the output of the previous one, the post processing reads the last output instead of the rtx texture
+	RenderGraph::Handle post_input = rtx_texture;
+	if (is_denoising()) {
+		for (int iteration = 0; iteration < m_DenoiserSettings.iterations; iteration++) {
+			RenderGraph::Handle output = m_RenderGraph.CreateTransientTexture(m_ViewportSize.x, m_ViewportSize.y);
+			RenderGraph::Pass& pass = m_RenderGraph.AddPass("Denoise", [this, iteration]() { denoise_iteration(iteration); })
+				.Read(post_input, Access::IMAGE, 6)
+				.Read(features, Access::IMAGE, 4)
+				.Read(albedo, Access::IMAGE, 5)
+				.Write(output, Access::IMAGE, 7);
+			if (iteration == 0) {
+				pass.Read(variance_texture, Access::IMAGE, 2);
+			}
+			post_input = output;
+		}
+	}
+
+	m_RenderGraph.AddPass("Post-process", [this]() {
+		update_postProcessing_parameters_UBO_block();
+		computePostProcShader->Bind();
+		computePostProcShader->DrawCall(ceil(m_ViewportSize.x / 8), ceil(m_ViewportSize.y / 4), 1);
+	})
+		.Read(post_input, Access::IMAGE, 0)
+		.Write(post_texture, Access::IMAGE, 1);
+
+	m_RenderGraph.Export(post_texture, Access::SAMPLE); // drawn by ImGui
+	m_RenderGraph.Execute();
+
+	// without tiles the whole image is traced every frame
+	if (!tiled) {
+		m_ResetPass = false;
+		m_NextTile = 0;
+		m_TilesPerFrame = getTileCount();
+	}
+
+	// the camera of this frame is the previous camera of the next one (the application overwrites only the current camera)
+	rtx_uniform_parameters.PrevCameraPos = rtx_uniform_parameters.CameraPos;
+	rtx_uniform_parameters.PrevFocalLength = rtx_uniform_parameters.FocalLength;
+	rtx_uniform_parameters.PrevModelMatrix = rtx_uniform_parameters.ModelMatrix;
+	m_HasPreviousCamera = is_reprojecting_enabled() && full_frame;
+	m_PreviousRenderSize = m_RenderSize;
+
+	return computePostProcTexture;
 }
 
-ComputeTexture* Renderer::RenderComputeRtxStage()
+void Renderer::renderRtx(bool adaptive, bool tiled, bool reproject, RenderGraph::Handle stats_texture)
 {
-	update_rtx_parameters_UBO_block();
-	update_TrisMesh_SSBO_block();
-	computeRtxShader->DrawCall(ceil(m_ViewportSize.x / 8), ceil(m_ViewportSize.y / 4), 1); // work_groups size
+	if (!tiled) { frameTimer->Begin((unsigned long long)m_RenderSize.x * m_RenderSize.y); }
 
-	read_PixelData_SSBO_block();
+	// the tracing overwrites the accumulated image and the depths, the reprojection reads the copies of the previous frame
+	if (reproject) {
+		GLCall(glCopyImageSubData(computeRtxTexture->ID(), GL_TEXTURE_2D, 0, 0, 0, 0, historyTexture->ID(), GL_TEXTURE_2D, 0, 0, 0, 0, m_RenderSize.x, m_RenderSize.y, 1));
+		GLCall(glCopyImageSubData(depthTexture->ID(), GL_TEXTURE_2D, 0, 0, 0, 0, historyDepthTexture->ID(), GL_TEXTURE_2D, 0, 0, 0, 0, m_RenderSize.x, m_RenderSize.y, 1));
+	}
+
+	GLCall(glClearNamedBufferData(rayCounter_SSBO_ID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+	// the stats image holds the work of the current frame only (tiles and adaptive sampling trace only some pixels)
+	if (m_TraversalStats) {
+		GLCall(glClearTexImage(m_RenderGraph.GetTextureID(stats_texture), 0, GL_RGBA, GL_FLOAT, nullptr));
+	}
 
-	return computeRtxTexture;
+	switch (m_TracingMode) {
+	case TracingMode::MEGAKERNEL:
+		if (adaptive) {
+			renderAdaptive();
+			break;
+		}
+		if (tiled) {
+			renderTiles();
+			break;
+		}
+		computeRtxShader->Bind();
+		computeRtxShader->SetUniform2i("u_tileOffset", 0, 0);
+		computeRtxShader->SetUniform1i("u_tileWasInput", 0);
+		computeRtxShader->DrawCall((m_RenderSize.x + 7) / 8, (m_RenderSize.y + 3) / 4, 1); // work_groups size
+		break;
+	case TracingMode::WAVEFRONT:
+		renderWavefront();
+		break;
+	case TracingMode::PERSISTENT_THREADS:
+		GLCall(glClearNamedBufferData(workCounter_SSBO_ID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+		computeRtxPersistentShader->Bind();
+		computeRtxPersistentShader->DrawCall(m_PersistentWorkGroups, 1, 1);
+		break;
+	}
+
+	if (!tiled) { frameTimer->End(); }
 }
 
+/**
+* The allocation pass lists the pixels which still need samples (and writes the indirect dispatch arguments),
+* the adaptive megakernel then traces only the listed pixels.
+*/
+void Renderer::renderAdaptive()
+{
+	unsigned int active_pixel_count;
+	if (activePixelCount_readback->TryRead(&active_pixel_count)) {
+		m_ActivePixelCount = active_pixel_count;
+	}
+
+	const unsigned int reset_values[4] = { 0, 1, 1, 0 }; // num_groups_x, num_groups_y, num_groups_z, active_pixel_count
+	GLCall(glNamedBufferSubData(activePixels_SSBO_ID, 0, sizeof(reset_values), reset_values));
 
-void Renderer::initComputePostProcStage()
+	adaptiveAllocateShader->Bind();
+	adaptiveAllocateShader->SetUniform1f("u_errorThreshold", m_ErrorThreshold);
+	adaptiveAllocateShader->SetUniform1ui("u_minAccumulatedFrames", m_MinAccumulatedFrames);
+	adaptiveAllocateShader->DrawCall((m_RenderSize.x + 7) / 8, (m_RenderSize.y + 3) / 4, 1);
+	// the list, the dispatch arguments and the count copied by the readback
+	GLCall(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+
+	computeRtxAdaptiveShader->Bind();
+	computeRtxAdaptiveShader->DrawCallIndirect(activePixels_SSBO_ID);
+
+	activePixelCount_readback->Enqueue(activePixels_SSBO_ID, 3 * sizeof(unsigned int));
+}
+
+/**
+* While moving, the traced area follows the ratio of the target and the expected full resolution frame time
+* (the resolution scale is the square root of it), otherwise the full resolution is traced.
+* The frame time is measured per traced pixel so the measurements of different scales can be mixed.
+* A change of the render size restarts the accumulation.
+*/
+void Renderer::update_render_size(bool is_moving, bool can_measure)
 {
-	computePostProcShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputePostProcessing.comp");
-	computePostProcShader->Bind();
-	configure_postProcessing_parameters_UBO_block();
+	double elapsed_ms;
+	unsigned long long measured_pixels;
+	while (frameTimer->Poll(elapsed_ms, measured_pixels)) {
+		if (measured_pixels == 0) {
+			continue;
+		}
+		double ms_per_pixel = elapsed_ms / measured_pixels;
+		m_FrameMsPerPixel = m_FrameMsPerPixel < 0.0 ? ms_per_pixel : m_FrameMsPerPixel * 0.7 + ms_per_pixel * 0.3;
+	}
+
+	float scale = m_ResolutionScale;
+	if (!m_DynamicResolution || !is_moving || !can_measure) {
+		scale = 1.0f;
+	}
+	else if (m_FrameMsPerPixel > 0.0) {
+		double full_resolution_ms = m_FrameMsPerPixel * m_ViewportSize.x * m_ViewportSize.y;
+		float target_scale = (float)std::clamp(std::sqrt(m_TargetFrameMs / full_resolution_ms), 0.25, 1.0);
+		// avoid resizing for small changes
+		if (std::abs(target_scale - m_ResolutionScale) >= 0.05f || target_scale == 1.0f) {
+			scale = target_scale;
+		}
+	}
+
+	glm::ivec2 render_size = glm::max(glm::ivec2(glm::vec2(m_ViewportSize) * scale), glm::ivec2(1));
+	if (render_size != m_RenderSize) {
+		m_RenderSize = render_size;
+		m_ResetPass = true;
+		m_NextTile = 0;
+		m_ResetPassFirstTile = 0;
+	}
+	m_ResolutionScale = scale;
 }
 
-void Renderer::BeginComputePostProcStage()
+unsigned int Renderer::getTileCount() const
 {
-	computePostProcShader->Bind();
+	unsigned int tiles_x = (m_RenderSize.x + m_TileSize - 1) / m_TileSize;
+	unsigned int tiles_y = (m_RenderSize.y + m_TileSize - 1) / m_TileSize;
+	return tiles_x * tiles_y;
 }
 
-ComputeTexture* Renderer::RenderComputePostProcStage()
+/**
+* The number of tiles traced this frame comes from the measured GPU cost of a pixel (timer queries of the previous frames),
+* at least one tile and at most the whole image is traced per frame.
+*/
+void Renderer::renderTiles()
 {
-	update_postProcessing_parameters_UBO_block();
-	computePostProcShader->DrawCall(ceil(m_ViewportSize.x / 8), ceil(m_ViewportSize.y / 4), 1);
-	return computePostProcTexture;
+	unsigned int tile_count = getTileCount();
+	if (tile_count == 0) {
+		return;
+	}
+	if (m_NextTile >= tile_count || m_ResetPassFirstTile >= tile_count) { // the viewport was resized
+		m_NextTile = 0;
+		m_ResetPassFirstTile = 0;
+	}
+	unsigned int tiles_x = (m_RenderSize.x + m_TileSize - 1) / m_TileSize;
+
+	double elapsed_ms;
+	unsigned long long measured_pixels;
+	while (tileTimer->Poll(elapsed_ms, measured_pixels)) {
+		if (measured_pixels == 0) {
+			continue;
+		}
+		double ms_per_pixel = elapsed_ms / measured_pixels;
+		m_MsPerPixel = m_MsPerPixel < 0.0 ? ms_per_pixel : m_MsPerPixel * 0.7 + ms_per_pixel * 0.3;
+	}
+
+	unsigned int tiles_this_frame = 1; // until the first measurement arrives
+	if (m_MsPerPixel > 0.0) {
+		double tile_ms = m_MsPerPixel * m_TileSize * m_TileSize;
+		tiles_this_frame = (unsigned int)std::clamp(m_FrameBudgetMs / tile_ms, 1.0, (double)tile_count);
+	}
+	m_TilesPerFrame = tiles_this_frame;
+
+	computeRtxShader->Bind();
+	tileTimer->Begin((unsigned long long)tiles_this_frame * m_TileSize * m_TileSize);
+	for (unsigned int i = 0; i < tiles_this_frame; i++) {
+		unsigned int tile = m_NextTile;
+		computeRtxShader->SetUniform2i("u_tileOffset", (tile % tiles_x) * m_TileSize, (tile / tiles_x) * m_TileSize);
+		computeRtxShader->SetUniform1i("u_tileWasInput", m_ResetPass ? 1 : 0);
+		computeRtxShader->DrawCall(m_TileSize / 8, m_TileSize / 4, 1);
+
+		m_NextTile = (m_NextTile + 1) % tile_count;
+		if (m_NextTile == m_ResetPassFirstTile && m_ResetPass) {
+			m_ResetPass = false; // every pixel was traced since the reset, the following tiles accumulate
+		}
+	}
+	tileTimer->End();
+}
+
+/**
+* Every sample of the frame: generate the camera rays into queue 0, then extend and shade the current queue
+* until every path terminated or used all its bounces (the shade pass fills the other queue), finally the
+* accumulate pass averages the samples into the texture.
+* The queue lengths never come back to the CPU, the dispatch args pass turns them into indirect dispatch arguments.
+* Every dispatch reads the results of the previous one, the barriers between them only carry the bits of the next reader
+* (the render graph takes care of the accesses before and after the whole pass).
+*/
+void Renderer::renderWavefront()
+{
+	if (m_WavefrontPathCount == 0) {
+		return;
+	}
+
+	unsigned int pixel_groups_x = (m_RenderSize.x + 7) / 8;
+	unsigned int pixel_groups_y = (m_RenderSize.y + 3) / 4;
+
+	// the extend pass adds to the stats of the pixel of its path, a path is extended once per bounce
+	GLbitfield extend_barrier = GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT;
+	if (m_TraversalStats) {
+		extend_barrier |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	}
+
+	for (unsigned int sample = 0; sample < rtx_uniform_parameters.raysPerPixel; sample++) {
+		if (sample > 0) {
+			GLCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+		}
+		GLCall(glClearNamedBufferData(queueCounters_SSBO_ID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+
+		wavefrontGenerateShader->Bind();
+		wavefrontGenerateShader->SetUniform1ui("u_sampleIndex", sample);
+		wavefrontGenerateShader->DrawCall(pixel_groups_x, pixel_groups_y, 1);
+		GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+		unsigned int queue = 0;
+		wavefrontDispatchArgsShader->Bind();
+		wavefrontDispatchArgsShader->SetUniform1ui("u_queueIndex", queue);
+		wavefrontDispatchArgsShader->DrawCall(1, 1, 1);
+
+		for (unsigned int bounce = 0; bounce <= rtx_uniform_parameters.bouncesPerRay; bounce++) {
+			GLCall(glMemoryBarrier(extend_barrier));
+			wavefrontExtendShader->Bind();
+			wavefrontExtendShader->SetUniform1ui("u_queueIndex", queue);
+			wavefrontExtendShader->DrawCallIndirect(queueCounters_SSBO_ID);
+			GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+			wavefrontShadeShader->Bind();
+			wavefrontShadeShader->SetUniform1ui("u_queueIndex", queue);
+			wavefrontShadeShader->DrawCallIndirect(queueCounters_SSBO_ID);
+			GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+			queue = 1 - queue;
+			wavefrontDispatchArgsShader->Bind();
+			wavefrontDispatchArgsShader->SetUniform1ui("u_queueIndex", queue);
+			wavefrontDispatchArgsShader->DrawCall(1, 1, 1);
+		}
+	}
+
+	// the reprojection reads the depths written by the shade pass
+	GLCall(glMemoryBarrier(is_reprojecting_enabled() ? GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT : GL_SHADER_STORAGE_BARRIER_BIT));
+	wavefrontAccumulateShader->Bind();
+	wavefrontAccumulateShader->DrawCall(pixel_groups_x, pixel_groups_y, 1);
+}
+
+
+void Renderer::initComputePostProcStage()
+{
+	computePostProcShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/ComputePostProcessing.comp");
+	denoiseShader = new ComputeShader(CORE_RESOURCES_PATH "shaders/denoise/Atrous.comp");
+	computePostProcShader->Bind();
+	configure_postProcessing_parameters_UBO_block();
 }
 
 // binding point 0
-void Renderer::configure_rtx_parameters_UBO_block() {	
-	GLCall(glGenBuffers(1, &rtx_parameters_UBO_ID));
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, rtx_parameters_UBO_ID));
-	GLCall(glBufferData(GL_UNIFORM_BUFFER, 188, nullptr, GL_DYNAMIC_DRAW));
-	GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, 0, rtx_parameters_UBO_ID)); // binding the uniform buffer object to binding point 0
+void Renderer::configure_rtx_parameters_UBO_block() {
+	rtx_parameters_UBO_ring = new UniformRingBuffer(sizeof(rtx_parameters_uniform_struct), 0);
 }
 
 void Renderer::update_rtx_parameters_UBO_block() {
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, rtx_parameters_UBO_ID));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 0,   sizeof(unsigned int), &rtx_uniform_parameters.numAccumulatedFrames));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 4,   sizeof(unsigned int), &rtx_uniform_parameters.raysPerPixel));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 8,   sizeof(unsigned int), &rtx_uniform_parameters.bouncesPerRay));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 12,  sizeof(float), &rtx_uniform_parameters.FocalLength));
-	
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 16,  sizeof(glm::vec3), &rtx_uniform_parameters.skyboxGroundColor));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 32,  sizeof(glm::vec3), &rtx_uniform_parameters.skyboxHorizonColor));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 48,  sizeof(glm::vec3), &rtx_uniform_parameters.skyboxZenithColor));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 64,  sizeof(glm::vec3), &rtx_uniform_parameters.CameraPos));
-	
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 80, sizeof(glm::vec3), &rtx_uniform_parameters.pixelGlobalInvocationID));
-	
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 96,  sizeof(glm::mat4), &rtx_uniform_parameters.ModelMatrix));
-
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 160, sizeof(bool), &rtx_uniform_parameters.WasInput));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 164, sizeof(bool), &rtx_uniform_parameters.display_BVH));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 168, sizeof(bool), &rtx_uniform_parameters.display_multiple));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 172, sizeof(unsigned int), &rtx_uniform_parameters.displayed_layer));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 176, sizeof(unsigned int), &rtx_uniform_parameters.BVH_tree_depth));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 180, sizeof(bool), &rtx_uniform_parameters.show_skybox));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 184, sizeof(int), &rtx_uniform_parameters.heatmap_color_limit));
-	
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, 0));
-}
-
-// binding point 1
-void Renderer::configure_sphereBuffer_UBO_block() {
-	GLCall(glGenBuffers(1, &sphereBuffer_UBO_ID));
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, sphereBuffer_UBO_ID));
-	GLCall(glBufferData(GL_UNIFORM_BUFFER, m_Scene.size, nullptr, GL_STATIC_DRAW));
-	GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, 1, sphereBuffer_UBO_ID)); 
-}
-
-void Renderer::update_sphereBuffer_UBO_block() {
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, sphereBuffer_UBO_ID));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 0, m_Scene.size, m_Scene.sceneObjects)); // sceneObjects are already a const void* pointer
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+	rtx_parameters_UBO_ring->Push(&rtx_uniform_parameters);
 }
 
 // binding point 2
 void Renderer::configure_postProcessing_parameters_UBO_block() {
-	unsigned int postProcessing_buffer_size_bytes = 4;
-	GLCall(glGenBuffers(1, &postProcessing_parameters_UBO_ID));
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, postProcessing_parameters_UBO_ID));
-	GLCall(glBufferData(GL_UNIFORM_BUFFER, postProcessing_buffer_size_bytes, nullptr, GL_DYNAMIC_DRAW));
-	GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, 2, postProcessing_parameters_UBO_ID)); // binding point 0
+	postProcessing_parameters_UBO_ring = new UniformRingBuffer(sizeof(postProcessing_parameters_uniform_struct), 2);
 }
 
 void Renderer::update_postProcessing_parameters_UBO_block() {
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, postProcessing_parameters_UBO_ID));
-	GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(unsigned int), &postProcessing_uniform_parameters.numAccumulatedFrames));
-	GLCall(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+	postProcessing_parameters_UBO_ring->Push(&postProcessing_uniform_parameters);
 }
 
-void Renderer::configure_TrisMesh_SSBO_block()
+void Renderer::configure_PixelData_SSBO_block()
 {
-	GLCall(glGenBuffers(1, &tris_SSBO_ID));
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, tris_SSBO_ID));
-	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Triangle) * BVH_of_mesh.TRIANGLES_size, nullptr, GL_STATIC_DRAW));
-	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tris_SSBO_ID));
+	GLCall(glGenBuffers(1, &pixelData_SSBO_ID));
+	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixelData_SSBO_ID));
+	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, 20, nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, pixelData_SSBO_ID));
+
+	pixelData_readback = new AsyncReadbackBuffer(20);
 }
 
-void Renderer::update_TrisMesh_SSBO_block()
+// binding point 6
+void Renderer::configure_RayCounter_SSBO_block()
 {
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, tris_SSBO_ID));
-	GLCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Triangle) * BVH_of_mesh.TRIANGLES_size, BVH_of_mesh.TRIANGLES.data()))
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0)); // unbind
+	GLCall(glCreateBuffers(1, &rayCounter_SSBO_ID));
+	GLCall(glNamedBufferData(rayCounter_SSBO_ID, sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, rayCounter_SSBO_ID));
+
+	rayCounter_readback = new AsyncReadbackBuffer(sizeof(unsigned int));
 }
 
-void Renderer::configure_BVH_SSBO_block()
+void Renderer::read_RayCounter_SSBO_block()
 {
-	GLCall(glGenBuffers(1, &BVH_SSBO_ID));
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, BVH_SSBO_ID));
-	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BVH::Node) * BVH_of_mesh.BVH_size, nullptr, GL_STATIC_DRAW));
-	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, BVH_SSBO_ID));
+	unsigned int ray_count;
+	if (rayCounter_readback->TryRead(&ray_count)) {
+		m_RaysPerFrame = ray_count;
+	}
+
+	rayCounter_readback->Enqueue(rayCounter_SSBO_ID);
 }
 
-void Renderer::update_BVH_SSBO_block()
+double Renderer::getRaysPerSecond() const
 {
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, BVH_SSBO_ID));
-	for (size_t i = 0; i < 3; i++) {
-		std::cout << BVH_of_mesh.BVH[i] << std::endl;
+	int rtx_zone = m_Profiler.FindZone("RTX");
+	if (rtx_zone < 0 || m_Profiler.GetLatestMs(rtx_zone) <= 0.0f) {
+		return 0.0;
 	}
-	GLCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(BVH::Node) * BVH_of_mesh.BVH_size, BVH_of_mesh.BVH.data()));
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0)); // unbind
+	return m_RaysPerFrame / (m_Profiler.GetLatestMs(rtx_zone) / 1000.0);
 }
 
-void Renderer::configure_PixelData_SSBO_block()
+bool Renderer::is_sampling_lights() const
 {
-	GLCall(glGenBuffers(1, &pixelData_SSBO_ID));
-	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixelData_SSBO_ID));
-	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, 20, nullptr, GL_DYNAMIC_READ));
-	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, pixelData_SSBO_ID));
+	return m_NextEventEstimation && getLightCount() > 0 && rtx_uniform_parameters.display_BVH == 0;
 }
 
-void Renderer::read_PixelData_SSBO_block() {
-    GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixelData_SSBO_ID));
+// binding point 13, the layout MUST match include/LightSampling.glsl
+void Renderer::configure_Lights_SSBO_block()
+{
+	GLCall(glCreateBuffers(1, &lights_SSBO_ID));
+	GLCall(glNamedBufferData(lights_SSBO_ID, sizeof(unsigned int) * m_LightList.size(), m_LightList.data(), GL_STATIC_DRAW));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, lights_SSBO_ID));
+}
+
+void Renderer::update_light_list()
+{
+	if (!m_LightsDirty) {
+		return;
+	}
+	m_LightsDirty = false;
+	m_LightsUploadPending = true;
+
+	auto is_emissive = [](const RaytracingMaterial& material) {
+		return material.emissionStrength > 0.0f && glm::any(glm::greaterThan(material.emissionColor, glm::vec3(0.0f)));
+	};
+
+	m_LightList.assign(4, 0u);
+	// the spheres are only known as raw std140 records (Sphere in the shaders), their material comes first
+	if (m_Scene.numberOfObjects > 0) {
+		size_t stride = m_Scene.size / m_Scene.numberOfObjects;
+		const char* records = static_cast<const char*>(m_Scene.sceneObjects);
+		for (int i = 0; i < m_Scene.numberOfObjects; i++) {
+			RaytracingMaterial material;
+			std::memcpy(&material, records + stride * i, sizeof(RaytracingMaterial));
+			if (is_emissive(material)) {
+				m_LightList.push_back(i);
+			}
+		}
+	}
+	unsigned int sphere_lights = (unsigned int)m_LightList.size() - 4;
+	for (unsigned int i = 0; i < BVH_of_mesh.TRIANGLES_size; i++) {
+		if (is_emissive(BVH_of_mesh.TRIANGLES[i].material)) {
+			m_LightList.push_back(i);
+		}
+	}
+	m_LightList[0] = (unsigned int)m_LightList.size() - 4;
+	m_LightList[1] = sphere_lights;
+}
+
+void Renderer::upload_Lights_SSBO_block()
+{
+	if (!m_LightsUploadPending) {
+		return;
+	}
+	m_LightsUploadPending = false;
+	GLCall(glNamedBufferData(lights_SSBO_ID, sizeof(unsigned int) * m_LightList.size(), m_LightList.data(), GL_STATIC_DRAW));
+}
+
+// binding point 12 (image binding point 3 is the stats texture)
+void Renderer::configure_TraversalStats_SSBO_block()
+{
+	GLCall(glCreateBuffers(1, &traversalStats_SSBO_ID));
+	GLCall(glNamedBufferData(traversalStats_SSBO_ID, sizeof(traversal_stats_SSBO_struct), nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, traversalStats_SSBO_ID));
+
+	traversalStats_readback = new AsyncReadbackBuffer(sizeof(traversal_stats_SSBO_struct));
+}
 
-	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+// the stats image (image binding point 3) is bound by the render graph
+void Renderer::reduce_traversal_stats()
+{
+	GLCall(glClearNamedBufferData(traversalStats_SSBO_ID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+	statsReduceShader->Bind();
+	statsReduceShader->SetUniform2i("u_statsSize", m_RenderSize.x, m_RenderSize.y);
+	statsReduceShader->DrawCall((m_RenderSize.x + 15) / 16, (m_RenderSize.y + 15) / 16, 1);
+}
 
-    PixelData* SSBO_pixelData_ptr = (PixelData*)glMapBufferRange(
-										GL_SHADER_STORAGE_BUFFER, 0,  20,
-										GL_MAP_READ_BIT);
+void Renderer::read_TraversalStats_SSBO_block()
+{
+	if (!m_TraversalStats) {
+		return;
+	}
 
-    if (SSBO_pixelData_ptr != nullptr) {
-		pixelData.pixelColor = SSBO_pixelData_ptr->pixelColor;
-		pixelData.AABB_intersect_count = SSBO_pixelData_ptr->AABB_intersect_count;
-		
+	traversal_stats_SSBO_struct totals;
+	if (traversalStats_readback->TryRead(&totals)) {
+		auto total = [&](unsigned int i) { return (unsigned long long)totals.totals[2 * i] | ((unsigned long long)totals.totals[2 * i + 1] << 32); };
+		m_LastTraversalStats.rays = total(0);
+		m_LastTraversalStats.bounces = total(1);
+		m_LastTraversalStats.node_visits = total(2);
+		m_LastTraversalStats.triangle_intersections = total(3);
+		m_LastTraversalStats.traced_pixels = totals.traced_pixels;
+		std::copy(std::begin(totals.cost_histogram), std::end(totals.cost_histogram), std::begin(m_LastTraversalStats.cost_histogram));
+	}
 
-		GLCall(glUnmapBuffer(GL_SHADER_STORAGE_BUFFER));
-    } 
-	else { std::cout << "Error mapping buffer" << std::endl; }
+	traversalStats_readback->Enqueue(traversalStats_SSBO_ID);
+}
+
+bool Renderer::is_denoising() const
+{
+	return m_Denoiser && rtx_uniform_parameters.display_BVH == 0;
+}
+
+// the feature images keep the primary hits of every pixel (tiles and adaptive sampling trace only some pixels per frame)
+void Renderer::update_denoiser_features()
+{
+	if (!is_denoising()) {
+		delete featureTexture;
+		delete albedoTexture;
+		featureTexture = nullptr;
+		albedoTexture = nullptr;
+		return;
+	}
+
+	if (featureTexture == nullptr || featureTexture->GetWidth() != (int)m_ViewportSize.x || featureTexture->GetHeight() != (int)m_ViewportSize.y) {
+		delete featureTexture;
+		delete albedoTexture;
+		featureTexture = new ComputeTexture(m_ViewportSize.x, m_ViewportSize.y, 4);
+		albedoTexture = new ComputeTexture(m_ViewportSize.x, m_ViewportSize.y, 5);
+		m_ResetPass = true; // every pixel has to be traced once to get its features
+		m_NextTile = 0;
+		m_ResetPassFirstTile = 0;
+	}
+}
+
+bool Renderer::is_reprojecting_enabled() const
+{
+	return m_TemporalReprojection && rtx_uniform_parameters.display_BVH == 0;
+}
+
+void Renderer::update_reprojection_textures()
+{
+	if (!is_reprojecting_enabled()) {
+		delete historyTexture;
+		delete depthTexture;
+		delete historyDepthTexture;
+		historyTexture = nullptr;
+		depthTexture = nullptr;
+		historyDepthTexture = nullptr;
+		m_HasPreviousCamera = false;
+		return;
+	}
+
+	if (depthTexture == nullptr || depthTexture->GetWidth() != (int)m_ViewportSize.x || depthTexture->GetHeight() != (int)m_ViewportSize.y) {
+		delete historyTexture;
+		delete depthTexture;
+		delete historyDepthTexture;
+		historyTexture = new ComputeTexture(m_ViewportSize.x, m_ViewportSize.y, 6);
+		depthTexture = new ComputeTexture(m_ViewportSize.x, m_ViewportSize.y, 1);
+		historyDepthTexture = new ComputeTexture(m_ViewportSize.x, m_ViewportSize.y, 7);
+		m_HasPreviousCamera = false; // no depths yet
+	}
+}
+
+// the input (image binding point 6) and the output (7) are bound by the render graph
+void Renderer::denoise_iteration(int iteration)
+{
+	denoiseShader->Bind();
+	denoiseShader->SetUniform2i("u_renderSize", m_RenderSize.x, m_RenderSize.y);
+	denoiseShader->SetUniform1i("u_stepWidth", 1 << iteration);
+	denoiseShader->SetUniform1i("u_firstIteration", iteration == 0);
+	denoiseShader->SetUniform1i("u_lastIteration", iteration == m_DenoiserSettings.iterations - 1);
+	denoiseShader->SetUniform1f("u_sigmaLuminance", m_DenoiserSettings.sigma_luminance);
+	denoiseShader->SetUniform1f("u_sigmaNormal", m_DenoiserSettings.sigma_normal);
+	denoiseShader->SetUniform1f("u_sigmaDepth", m_DenoiserSettings.sigma_depth);
+	denoiseShader->SetUniform1f("u_sigmaAlbedo", m_DenoiserSettings.sigma_albedo);
+	denoiseShader->DrawCall((m_RenderSize.x + 7) / 8, (m_RenderSize.y + 3) / 4, 1);
+}
+
+// binding point 10
+bool Renderer::query_subgroup_ops() const
+{
+	GLint extension_count = 0;
+	GLCall(glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count));
+	bool supported = false;
+	for (GLint i = 0; i < extension_count && !supported; i++) {
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		supported = extension && std::strcmp(extension, "GL_KHR_shader_subgroup") == 0;
+	}
+	if (!supported) {
+		return false;
+	}
+
+	// the basic operations are guaranteed in compute shaders, the ballot ones (subgroupBroadcastFirst) are optional
+	GLint stages = 0, features = 0;
+	GLCall(glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages));
+	GLCall(glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features));
+	return (stages & GL_COMPUTE_SHADER_BIT) && (features & GL_SUBGROUP_FEATURE_BALLOT_BIT_KHR);
+}
+
+void Renderer::configure_WorkCounter_SSBO_block()
+{
+	GLCall(glCreateBuffers(1, &workCounter_SSBO_ID));
+	GLCall(glNamedBufferData(workCounter_SSBO_ID, sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, workCounter_SSBO_ID));
+}
+
+// binding point 11, the size MUST match include/AdaptiveSampling.glsl
+void Renderer::configure_ActivePixels_SSBO_block()
+{
+	size_t pixel_count = (size_t)m_ViewportSize.x * (size_t)m_ViewportSize.y;
+
+	glDeleteBuffers(1, &activePixels_SSBO_ID);
+	GLCall(glCreateBuffers(1, &activePixels_SSBO_ID));
+	GLCall(glNamedBufferData(activePixels_SSBO_ID, 4 * sizeof(unsigned int) + sizeof(unsigned int) * std::max(pixel_count, (size_t)1), nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, activePixels_SSBO_ID));
+}
+
+// binding points 7, 8 and 9, the sizes MUST match include/WavefrontCommon.glsl
+void Renderer::configure_Wavefront_SSBO_blocks()
+{
+	const size_t path_state_size = 144;
+	const size_t queue_counters_size = 5 * sizeof(unsigned int);
+
+	glDeleteBuffers(1, &pathStates_SSBO_ID);
+	glDeleteBuffers(1, &rayQueues_SSBO_ID);
+	glDeleteBuffers(1, &queueCounters_SSBO_ID);
+
+	GLCall(glCreateBuffers(1, &pathStates_SSBO_ID));
+	GLCall(glNamedBufferData(pathStates_SSBO_ID, path_state_size * m_WavefrontPathCount, nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, pathStates_SSBO_ID));
+
+	GLCall(glCreateBuffers(1, &rayQueues_SSBO_ID));
+	GLCall(glNamedBufferData(rayQueues_SSBO_ID, 2 * sizeof(unsigned int) * m_WavefrontPathCount, nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, rayQueues_SSBO_ID));
+
+	GLCall(glCreateBuffers(1, &queueCounters_SSBO_ID));
+	GLCall(glNamedBufferData(queueCounters_SSBO_ID, queue_counters_size, nullptr, GL_DYNAMIC_COPY));
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, queueCounters_SSBO_ID));
+}
+
+void Renderer::read_PixelData_SSBO_block() {
+	if (!m_PixelDataReadback) {
+		return;
+	}
+
+	// results of earlier frames, never waits for the GPU
+	PixelData readback_pixelData;
+	if (pixelData_readback->TryRead(&readback_pixelData)) {
+		pixelData = readback_pixelData;
+	}
 
-    GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+	pixelData_readback->Enqueue(pixelData_SSBO_ID);
 }
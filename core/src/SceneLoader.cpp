@@ -0,0 +1,141 @@
+#include "core/SceneLoader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "core/ObjParser/MeshFile.h"
+#include "core/util/Parallel.h"
+#include "core/util/Profiler.h"
+
+// share of the overall progress taken by loading the mesh (the rest is the BVH build)
+static const float mesh_loading_share = 0.25f;
+
+SceneLoader::SceneLoader()
+	: m_Stage(Stage::IDLE), m_Progress(0.0f), m_FinishedSeconds(-1.0)
+{
+}
+
+SceneLoader::~SceneLoader()
+{
+	if (m_Worker.joinable()) {
+		m_Worker.join();
+	}
+}
+
+void SceneLoader::Start(const std::string& path, BVH::Heuristic heuristic)
+{
+	BVH::ModelInstance model;
+	model.path = path;
+	Start(std::vector<BVH::ModelInstance>{ model }, heuristic);
+}
+
+void SceneLoader::Start(const std::vector<BVH::ModelInstance>& models, BVH::Heuristic heuristic)
+{
+	if (m_Worker.joinable()) {
+		m_Worker.join();
+	}
+
+	m_Path = models.empty() ? "" : models[0].path;
+	if (models.size() > 1) {
+		m_Path += " (+" + std::to_string(models.size() - 1) + " more)";
+	}
+	m_Progress = 0.0f;
+	m_FinishedSeconds = -1.0;
+	m_StartTime = std::chrono::steady_clock::now();
+	m_Stage = Stage::LOADING_MESH;
+
+	m_Worker = std::thread(&SceneLoader::Run, this, models, heuristic);
+}
+
+void SceneLoader::Run(std::vector<BVH::ModelInstance> models, BVH::Heuristic heuristic)
+{
+	Profiler::setThreadName("Scene loader");
+	PROFILE_SCOPE("SceneLoader::Run");
+
+	auto onProgress = [this](BVH::BuildStage stage, float stage_progress) {
+		switch (stage) {
+		case BVH::BuildStage::LOADING_MESH:
+			m_Stage = Stage::LOADING_MESH;
+			m_Progress = mesh_loading_share * stage_progress;
+			break;
+		case BVH::BuildStage::BUILDING_BVH:
+			m_Stage = Stage::BUILDING_BVH;
+			m_Progress = mesh_loading_share + (1.0f - mesh_loading_share) * stage_progress;
+			break;
+		case BVH::BuildStage::DONE:
+			m_Progress = 1.0f;
+			break;
+		}
+	};
+
+	try {
+		onProgress(BVH::BuildStage::LOADING_MESH, 0.0f);
+		// converts the models on the first launch, every file once (instances may share it)
+		std::vector<std::string> paths;
+		for (const BVH::ModelInstance& model : models) {
+			if (std::find(paths.begin(), paths.end(), model.path) == paths.end()) {
+				paths.push_back(model.path);
+			}
+		}
+		std::vector<std::string> cached_paths(paths.size());
+		Parallel::forEach(paths.size(), [&](size_t i) {
+			cached_paths[i] = MeshFile::getCached(paths[i]);
+		});
+		for (BVH::ModelInstance& model : models) {
+			model.path = cached_paths[std::find(paths.begin(), paths.end(), model.path) - paths.begin()];
+		}
+		m_Result = BVH::constructScene(models, heuristic, onProgress);
+	}
+	catch (const std::exception& exception) {
+		std::cerr << "SceneLoader - failed to load " << m_Path << ": " << exception.what() << std::endl;
+		m_Result = BVH::BVH_data();
+	}
+
+	m_FinishedSeconds = GetElapsedSeconds();
+	std::cout << "SceneLoader - " << m_Path << " loaded in " << m_FinishedSeconds.load() << " s" << std::endl;
+
+	m_Stage = m_Result.BVH_size > 0 ? Stage::READY : Stage::FAILED;
+}
+
+BVH::BVH_data SceneLoader::TakeResult()
+{
+	if (m_Worker.joinable()) {
+		m_Worker.join(); // the worker is done once the result is ready, this only releases the thread
+	}
+	m_Stage = Stage::FINISHED;
+	return std::move(m_Result);
+}
+
+const char* SceneLoader::GetStageName() const
+{
+	switch (m_Stage.load()) {
+	case Stage::IDLE:			return "Idle";
+	case Stage::LOADING_MESH:	return "Loading mesh";
+	case Stage::BUILDING_BVH:	return "Building BVH";
+	case Stage::READY:			return "Uploading";
+	case Stage::FINISHED:		return "Finished";
+	case Stage::FAILED:			return "Failed";
+	}
+	return "";
+}
+
+double SceneLoader::GetElapsedSeconds() const
+{
+	if (m_FinishedSeconds.load() >= 0.0) {
+		return m_FinishedSeconds.load();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+}
+
+double SceneLoader::GetEstimatedSecondsLeft() const
+{
+	float progress = m_Progress.load();
+	if (progress >= 1.0f) {
+		return 0.0;
+	}
+	if (progress < 0.01f) {
+		return -1.0;
+	}
+	double elapsed = GetElapsedSeconds();
+	return elapsed * (1.0 - progress) / progress;
+}
@@ -0,0 +1,82 @@
+#include "core/gl_util/AsyncReadbackBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+AsyncReadbackBuffer::AsyncReadbackBuffer(size_t size, unsigned int slot_count)
+	: m_RendererID(0), m_Size(size), m_SlotStride((size + 15) / 16 * 16),
+	m_Slots(slot_count), m_NextSlot(0), m_NextSequence(1),
+	m_MappedPtr(nullptr)
+{
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLCall(glCreateBuffers(1, &m_RendererID));
+	GLCall(glNamedBufferStorage(m_RendererID, m_SlotStride * slot_count, nullptr, flags));
+	m_MappedPtr = (unsigned char*)glMapNamedBufferRange(m_RendererID, 0, m_SlotStride * slot_count, flags);
+
+	if (m_MappedPtr == nullptr) { std::cout << "Error mapping readback buffer" << std::endl; }
+}
+
+AsyncReadbackBuffer::~AsyncReadbackBuffer()
+{
+	for (Slot& slot : m_Slots) {
+		if (slot.fence != nullptr) {
+			glDeleteSync(slot.fence);
+		}
+	}
+	GLCall(glUnmapNamedBuffer(m_RendererID));
+	GLCall(glDeleteBuffers(1, &m_RendererID));
+}
+
+void AsyncReadbackBuffer::Enqueue(unsigned int source_buffer, size_t source_offset)
+{
+	Slot& slot = m_Slots[m_NextSlot];
+	if (slot.fence != nullptr) {
+		// the copy in this slot was never read, it is replaced by a newer one
+		glDeleteSync(slot.fence);
+	}
+
+	GLCall(glCopyNamedBufferSubData(source_buffer, m_RendererID, source_offset, m_SlotStride * m_NextSlot, m_Size));
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.sequence = m_NextSequence++;
+
+	m_NextSlot = (m_NextSlot + 1) % m_Slots.size();
+}
+
+bool AsyncReadbackBuffer::TryRead(void* destination)
+{
+	int newest_ready_slot = -1;
+	for (size_t i = 0; i < m_Slots.size(); i++) {
+		Slot& slot = m_Slots[i];
+		if (slot.fence == nullptr) {
+			continue;
+		}
+
+		// zero timeout, only polls the fence
+		GLenum status = glClientWaitSync(slot.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			continue;
+		}
+		if (newest_ready_slot == -1 || slot.sequence > m_Slots[newest_ready_slot].sequence) {
+			newest_ready_slot = (int)i;
+		}
+	}
+
+	if (newest_ready_slot == -1) {
+		return false;
+	}
+
+	// slots older than the one being read are stale now
+	unsigned long long newest_sequence = m_Slots[newest_ready_slot].sequence;
+	for (Slot& slot : m_Slots) {
+		if (slot.fence != nullptr && slot.sequence <= newest_sequence) {
+			glDeleteSync(slot.fence);
+			slot.fence = nullptr;
+		}
+	}
+
+	if (m_MappedPtr == nullptr) {
+		return false;
+	}
+	std::memcpy(destination, m_MappedPtr + m_SlotStride * newest_ready_slot, m_Size);
+	return true;
+}
@@ -4,18 +4,40 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <filesystem>
 
 #include "core/gl_util/OpenGLdebugFuncs.h"
+#include "core/gl_util/ShaderCache.h"
 
-ComputeShader::ComputeShader(const std::string& filepath)
- : m_Filepath(filepath), m_RendererID(0)
+ComputeShader::ComputeShader(const std::string& filepath, const ShaderDefines& defines)
+ : m_Filepath(filepath), m_RendererID(0), m_Defines(defines)
 {
 	m_RendererID = CreateShader();
+	m_Variants[m_Defines] = m_RendererID;
 }
 
 ComputeShader::~ComputeShader()
 {
-	GLCall(glDeleteProgram(m_RendererID));
+	for (auto& variant : m_Variants) {
+		GLCall(glDeleteProgram(variant.second));
+	}
+}
+
+void ComputeShader::SetDefines(const ShaderDefines& defines)
+{
+	if (defines == m_Defines) {
+		return;
+	}
+	m_Defines = defines;
+	m_UniformLocationCache.clear();
+
+	auto it = m_Variants.find(m_Defines);
+	if (it != m_Variants.end()) {
+		m_RendererID = it->second;
+		return;
+	}
+	m_RendererID = CreateShader();
+	m_Variants[m_Defines] = m_RendererID;
 }
 
 
@@ -34,18 +56,80 @@ void ComputeShader::DrawCall(unsigned int workGroups_x, unsigned int workGroups_
 	this->workGroups_x = workGroups_x;
 	this->workGroups_y = workGroups_y;
 	this->workGroups_z = workGroups_z;
-	glDispatchCompute(workGroups_x, workGroups_y, workGroups_z);
-	GLCall(glMemoryBarrier(GL_ALL_BARRIER_BITS))
+	GLCall(glDispatchCompute(workGroups_x, workGroups_y, workGroups_z));
+}
+
+void ComputeShader::DrawCallIndirect(unsigned int indirect_buffer, size_t offset)
+{
+	GLCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirect_buffer));
+	GLCall(glDispatchComputeIndirect((GLintptr)offset));
+}
+
+void ComputeShader::SetUniform1i(const std::string& name, int value)
+{
+	GLCall(glProgramUniform1i(m_RendererID, GetUniformLocation(name), value));
+}
+
+void ComputeShader::SetUniform1ui(const std::string& name, unsigned int value)
+{
+	GLCall(glProgramUniform1ui(m_RendererID, GetUniformLocation(name), value));
+}
+
+void ComputeShader::SetUniform1f(const std::string& name, float value)
+{
+	GLCall(glProgramUniform1f(m_RendererID, GetUniformLocation(name), value));
+}
+
+void ComputeShader::SetUniform2i(const std::string& name, int x, int y)
+{
+	GLCall(glProgramUniform2i(m_RendererID, GetUniformLocation(name), x, y));
 }
 
-std::string ComputeShader::ParseShader(const std::string& filepath)
+int ComputeShader::GetUniformLocation(const std::string& name)
+{
+	auto it = m_UniformLocationCache.find(name);
+	if (it != m_UniformLocationCache.end()) {
+		return it->second;
+	}
+
+	int location = glGetUniformLocation(m_RendererID, name.c_str());
+	if (location == -1) {
+		std::cout << "Warning: uniform '" << name << "' doesn't exist in " << m_Filepath << std::endl;
+	}
+	m_UniformLocationCache[name] = location;
+	return location;
+}
+
+std::string ComputeShader::ParseShader(const std::string& filepath, std::unordered_set<std::string>& included_files)
 {
 	std::ifstream stream(filepath);
+	if (!stream.is_open()) {
+		std::cout << "Failed to open the shader file " << filepath << std::endl;
+		return "";
+	}
+	included_files.insert(filepath);
+
+	std::string directory = filepath.substr(0, filepath.find_last_of("/\\") + 1);
 
 	std::stringstream ss;
 	std::string line;
 	while (getline(stream, line)) // loop through every line and write it to a string stream
 	{
+		size_t directive = line.find("#include");
+		if (directive != std::string::npos && line.find_first_not_of(" \t") == directive) {
+			size_t path_begin = line.find('"', directive);
+			size_t path_end = line.find('"', path_begin + 1);
+			if (path_begin == std::string::npos || path_end == std::string::npos) {
+				std::cout << "Invalid #include in " << filepath << ": " << line << std::endl;
+				continue;
+			}
+
+			std::string include_path = std::filesystem::path(directory + line.substr(path_begin + 1, path_end - path_begin - 1)).lexically_normal().string();
+			if (included_files.count(include_path) == 0) {
+				ss << ParseShader(include_path, included_files);
+			}
+			continue;
+		}
 		ss << line << '\n';
 	}
 
@@ -53,9 +137,39 @@ std::string ComputeShader::ParseShader(const std::string& filepath)
 	return source; // converting to c style string
 }
 
+std::string ComputeShader::InjectDefines(const std::string& source) const
+{
+	if (m_Defines.empty()) {
+		return source;
+	}
+
+	std::string defines;
+	for (const auto& define : m_Defines) {
+		defines += "#define " + define.first + " " + define.second + "\n";
+	}
+
+	// #version has to stay the first directive of the shader
+	size_t version = source.find("#version");
+	size_t insert_at = version == std::string::npos ? 0 : source.find('\n', version);
+	if (insert_at == std::string::npos) {
+		return source + "\n" + defines;
+	}
+	insert_at = version == std::string::npos ? 0 : insert_at + 1;
+	return source.substr(0, insert_at) + defines + source.substr(insert_at);
+}
+
 unsigned int ComputeShader::CreateShader()
 {
-	std::string computeShaderSource = ParseShader(m_Filepath);
+	std::unordered_set<std::string> included_files;
+	std::string computeShaderSource = InjectDefines(ParseShader(m_Filepath, included_files));
+
+	// warm start: the linked binary from a previous run skips the compilation
+	uint64_t cache_key = ShaderCache::ComputeKey(computeShaderSource);
+	GLuint cachedProgram = ShaderCache::Load(cache_key);
+	if (cachedProgram != 0) {
+		return cachedProgram;
+	}
+
 	const char* src = &computeShaderSource[0];
 	GLuint computeShaderID = glCreateShader(GL_COMPUTE_SHADER);
 	
@@ -79,10 +193,17 @@ unsigned int ComputeShader::CreateShader()
 
 	GLuint computeProgram = glCreateProgram(); // is m_RendererID
 	GLCall(glAttachShader(computeProgram, computeShaderID));
+	GLCall(glProgramParameteri(computeProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
 	GLCall(glLinkProgram(computeProgram));
 	// cleanup
 	GLCall(glValidateProgram(computeProgram));
 	GLCall(glDeleteShader(computeShaderID));
 
+	int link_status = GL_FALSE;
+	GLCall(glGetProgramiv(computeProgram, GL_LINK_STATUS, &link_status));
+	if (link_status == GL_TRUE) {
+		ShaderCache::Store(computeProgram, cache_key);
+	}
+
 	return computeProgram;
 }
@@ -0,0 +1,170 @@
+#include "core/gl_util/GPUProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+GPUProfiler::GPUProfiler(unsigned int frames_in_flight, unsigned int history_length)
+	: m_Frames(frames_in_flight), m_CurrentFrame(0), m_FrameNumber(0), m_InFrame(false),
+	m_HistoryFrames(history_length, 0), m_HistoryLength(history_length), m_HistoryHead(0), m_HistoryCount(0)
+{
+	GetZoneIndex("Frame");
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	for (Frame& frame : m_Frames) {
+		if (!frame.queries.empty()) {
+			GLCall(glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data()));
+		}
+	}
+}
+
+void GPUProfiler::BeginFrame()
+{
+	m_CurrentFrame = (m_CurrentFrame + 1) % m_Frames.size();
+	Frame& frame = m_Frames[m_CurrentFrame];
+	// the GPU is more than frames_in_flight frames behind, the oldest result is dropped
+	frame.number = 0;
+	frame.used_queries = 0;
+	frame.zones.clear();
+
+	m_InFrame = true;
+	m_OpenZones.clear();
+	BeginZone("Frame");
+}
+
+void GPUProfiler::EndFrame()
+{
+	if (!m_InFrame) {
+		return;
+	}
+	while (!m_OpenZones.empty()) {
+		EndZone();
+	}
+	m_InFrame = false;
+	m_Frames[m_CurrentFrame].number = ++m_FrameNumber;
+
+	ResolveFinishedFrames();
+}
+
+void GPUProfiler::BeginZone(const char* name)
+{
+	if (!m_InFrame) {
+		return;
+	}
+	Frame& frame = m_Frames[m_CurrentFrame];
+	m_OpenZones.push_back((unsigned int)frame.zones.size());
+	frame.zones.push_back({ GetZoneIndex(name), WriteTimestamp(frame), 0 });
+}
+
+void GPUProfiler::EndZone()
+{
+	if (!m_InFrame || m_OpenZones.empty()) {
+		return;
+	}
+	Frame& frame = m_Frames[m_CurrentFrame];
+	frame.zones[m_OpenZones.back()].end_query = WriteTimestamp(frame);
+	m_OpenZones.pop_back();
+}
+
+int GPUProfiler::FindZone(const char* name) const
+{
+	for (unsigned int i = 0; i < m_ZoneNames.size(); i++) {
+		if (m_ZoneNames[i] == name) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+unsigned int GPUProfiler::GetZoneIndex(const char* name)
+{
+	int zone = FindZone(name);
+	if (zone >= 0) {
+		return (unsigned int)zone;
+	}
+	m_ZoneNames.emplace_back(name);
+	m_History.emplace_back(m_HistoryLength, 0.0f);
+	m_Latest.push_back(0.0f);
+	return (unsigned int)m_ZoneNames.size() - 1;
+}
+
+unsigned int GPUProfiler::WriteTimestamp(Frame& frame)
+{
+	if (frame.used_queries == frame.queries.size()) {
+		unsigned int query;
+		GLCall(glGenQueries(1, &query));
+		frame.queries.push_back(query);
+	}
+	GLCall(glQueryCounter(frame.queries[frame.used_queries], GL_TIMESTAMP));
+	return frame.used_queries++;
+}
+
+void GPUProfiler::ResolveFinishedFrames()
+{
+	// the frames are resolved in order, the GPU finishes them in order
+	for (unsigned int i = 1; i <= m_Frames.size(); i++) {
+		Frame& frame = m_Frames[(m_CurrentFrame + i) % m_Frames.size()];
+		if (frame.number != 0 && !Resolve(frame)) {
+			return;
+		}
+	}
+}
+
+bool GPUProfiler::Resolve(Frame& frame)
+{
+	// the timestamps complete in order, the last one of the frame being available means all are
+	int available = 0;
+	GLCall(glGetQueryObjectiv(frame.queries[frame.used_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+	if (!available) {
+		return false;
+	}
+
+	std::vector<GLuint64> timestamps(frame.used_queries);
+	for (unsigned int i = 0; i < frame.used_queries; i++) {
+		GLCall(glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]));
+	}
+
+	std::fill(m_Latest.begin(), m_Latest.end(), 0.0f);
+	for (const ZoneRecord& zone : frame.zones) {
+		m_Latest[zone.zone] += float((timestamps[zone.end_query] - timestamps[zone.begin_query]) / 1.0e6);
+	}
+
+	for (unsigned int zone = 0; zone < m_ZoneNames.size(); zone++) {
+		m_History[zone][m_HistoryHead] = m_Latest[zone];
+	}
+	m_HistoryFrames[m_HistoryHead] = frame.number;
+	m_HistoryHead = (m_HistoryHead + 1) % m_HistoryLength;
+	m_HistoryCount = std::min(m_HistoryCount + 1, m_HistoryLength);
+
+	frame.number = 0;
+	return true;
+}
+
+bool GPUProfiler::ExportCSV(const std::string& filepath) const
+{
+	std::ofstream file(filepath);
+	if (!file.is_open()) {
+		std::cout << "Failed to write the GPU profile " << filepath << std::endl;
+		return false;
+	}
+
+	file << "frame";
+	for (const std::string& name : m_ZoneNames) {
+		file << ",\"" << name << " [ms]\"";
+	}
+	file << '\n';
+
+	for (unsigned int i = 0; i < m_HistoryCount; i++) {
+		unsigned int row = (m_HistoryHead + m_HistoryLength - m_HistoryCount + i) % m_HistoryLength;
+		file << m_HistoryFrames[row];
+		for (const std::vector<float>& history : m_History) {
+			file << ',' << history[row];
+		}
+		file << '\n';
+	}
+	return true;
+}
@@ -0,0 +1,70 @@
+#include "core/gl_util/GPUResourceManager.h"
+
+#include <algorithm>
+
+#include "core/util/Profiler.h"
+
+GPUBuffer::GPUBuffer(GLenum target, unsigned int binding_point)
+	: m_RendererID(0), m_Target(target), m_BindingPoint(binding_point), m_Source(nullptr), m_Size(0), m_Dirty(false)
+{
+}
+
+GPUBuffer::~GPUBuffer()
+{
+	if (m_RendererID != 0) {
+		GLCall(glDeleteBuffers(1, &m_RendererID));
+	}
+}
+
+void GPUBuffer::Allocate(size_t size)
+{
+	if (m_RendererID != 0) {
+		GLCall(glDeleteBuffers(1, &m_RendererID));
+	}
+
+	// GL doesn't like zero sized buffers bound to a binding point
+	GLCall(glCreateBuffers(1, &m_RendererID));
+	GLCall(glNamedBufferData(m_RendererID, std::max<size_t>(size, 16), nullptr, GL_STATIC_DRAW));
+	GLCall(glBindBufferBase(m_Target, m_BindingPoint, m_RendererID));
+}
+
+void GPUBuffer::SetSource(const void* data, size_t size)
+{
+	if (m_RendererID == 0 || size != m_Size) {
+		Allocate(size);
+	}
+	m_Source = static_cast<const unsigned char*>(data);
+	m_Size = size;
+	m_Dirty = size > 0;
+}
+
+size_t GPUBuffer::Upload()
+{
+	size_t uploaded_bytes = 0;
+	if (m_Dirty && m_Source != nullptr) {
+		GLCall(glNamedBufferSubData(m_RendererID, 0, m_Size, m_Source));
+		uploaded_bytes = m_Size;
+	}
+	m_Dirty = false;
+	return uploaded_bytes;
+}
+
+GPUResourceManager::GPUResourceManager()
+	: m_LastUploadedBytes(0)
+{
+	m_Buffers.resize(static_cast<size_t>(Resource::COUNT));
+	m_Buffers[static_cast<size_t>(Resource::SPHERES)] = std::make_unique<GPUBuffer>(GL_UNIFORM_BUFFER, 1);
+	m_Buffers[static_cast<size_t>(Resource::MESH)] = std::make_unique<GPUBuffer>(GL_SHADER_STORAGE_BUFFER, 3);
+	m_Buffers[static_cast<size_t>(Resource::BVH)] = std::make_unique<GPUBuffer>(GL_SHADER_STORAGE_BUFFER, 4);
+}
+
+void GPUResourceManager::Flush()
+{
+	PROFILE_SCOPE("GPUResourceManager::Flush");
+	m_LastUploadedBytes = 0;
+	for (std::unique_ptr<GPUBuffer>& buffer : m_Buffers) {
+		if (buffer->IsDirty()) {
+			m_LastUploadedBytes += buffer->Upload();
+		}
+	}
+}
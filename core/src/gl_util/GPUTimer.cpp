@@ -0,0 +1,57 @@
+#include "core/gl_util/GPUTimer.h"
+
+GPUTimer::GPUTimer(unsigned int query_count)
+	: m_Queries(query_count), m_NextQuery(0), m_NextSequence(1)
+{
+	for (Query& query : m_Queries) {
+		GLCall(glGenQueries(1, &query.id));
+	}
+}
+
+GPUTimer::~GPUTimer()
+{
+	for (Query& query : m_Queries) {
+		GLCall(glDeleteQueries(1, &query.id));
+	}
+}
+
+void GPUTimer::Begin(unsigned long long tag)
+{
+	// when every query is still pending the oldest result is dropped
+	Query& query = m_Queries[m_NextQuery];
+	query.tag = tag;
+	query.sequence = m_NextSequence++;
+	GLCall(glBeginQuery(GL_TIME_ELAPSED, query.id));
+}
+
+void GPUTimer::End()
+{
+	GLCall(glEndQuery(GL_TIME_ELAPSED));
+	m_NextQuery = (m_NextQuery + 1) % m_Queries.size();
+}
+
+bool GPUTimer::Poll(double& elapsed_ms, unsigned long long& tag)
+{
+	Query* oldest = nullptr;
+	for (Query& query : m_Queries) {
+		if (query.sequence != 0 && (oldest == nullptr || query.sequence < oldest->sequence)) {
+			oldest = &query;
+		}
+	}
+	if (oldest == nullptr) {
+		return false;
+	}
+
+	int available = 0;
+	GLCall(glGetQueryObjectiv(oldest->id, GL_QUERY_RESULT_AVAILABLE, &available));
+	if (!available) {
+		return false;
+	}
+
+	GLuint64 elapsed_ns = 0;
+	GLCall(glGetQueryObjectui64v(oldest->id, GL_QUERY_RESULT, &elapsed_ns));
+	elapsed_ms = elapsed_ns / 1.0e6;
+	tag = oldest->tag;
+	oldest->sequence = 0;
+	return true;
+}
@@ -0,0 +1,326 @@
+#include "core/gl_util/RenderGraph.h"
+
+#include <algorithm>
+
+#include "core/gl_util/GPUProfiler.h"
+#include "core/util/Profiler.h"
+
+namespace {
+	// the barrier bit which makes incoherent shader writes visible to the access
+	GLbitfield barrierBit(RenderGraph::Access access, bool texture)
+	{
+		switch (access) {
+		case RenderGraph::Access::IMAGE:	return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		case RenderGraph::Access::STORAGE:	return GL_SHADER_STORAGE_BARRIER_BIT;
+		case RenderGraph::Access::UNIFORM:	return GL_UNIFORM_BARRIER_BIT;
+		case RenderGraph::Access::INDIRECT:	return GL_COMMAND_BARRIER_BIT;
+		case RenderGraph::Access::TRANSFER:	return texture ? GL_TEXTURE_UPDATE_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT;
+		case RenderGraph::Access::SAMPLE:	return GL_TEXTURE_FETCH_BARRIER_BIT;
+		}
+		return GL_ALL_BARRIER_BITS;
+	}
+
+	// only shader writes are incoherent, GL commands (clears, copies, uploads) are ordered by themselves
+	bool isShaderWrite(RenderGraph::Access access)
+	{
+		return access == RenderGraph::Access::IMAGE || access == RenderGraph::Access::STORAGE;
+	}
+
+	// transients are freed when the pool didn't need them for this many frames
+	const unsigned int max_unused_frames = 60;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Read(Handle resource, Access access, int binding)
+{
+	m_Accesses.push_back({ resource, access, false, binding });
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Write(Handle resource, Access access, int binding)
+{
+	m_Accesses.push_back({ resource, access, true, binding });
+	return *this;
+}
+
+RenderGraph::RenderGraph(GPUProfiler* profiler)
+	: m_Profiler(profiler), m_LastBarrierCount(0)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	for (PooledTexture& pooled : m_TexturePool) {
+		GLCall(glDeleteTextures(1, &pooled.id));
+	}
+}
+
+RenderGraph::Handle RenderGraph::Import(bool texture, unsigned int id)
+{
+	for (Handle handle = 0; handle < m_Resources.size(); handle++) {
+		if (!m_Resources[handle].transient && m_Resources[handle].texture == texture && m_Resources[handle].id == id) {
+			return handle;
+		}
+	}
+	m_Resources.push_back({ texture, false, id, 0, 0, -1, -1 });
+	return (Handle)m_Resources.size() - 1;
+}
+
+RenderGraph::Handle RenderGraph::ImportTexture(unsigned int texture_id)
+{
+	return Import(true, texture_id);
+}
+
+RenderGraph::Handle RenderGraph::ImportBuffer(unsigned int buffer_id)
+{
+	return Import(false, buffer_id);
+}
+
+RenderGraph::Handle RenderGraph::CreateTransientTexture(int width, int height)
+{
+	m_Resources.push_back({ true, true, 0, width, height, -1, -1 });
+	return (Handle)m_Resources.size() - 1;
+}
+
+RenderGraph::Pass& RenderGraph::AddPass(const char* name, std::function<void()> execute)
+{
+	m_Passes.emplace_back();
+	Pass& pass = m_Passes.back();
+	pass.m_Name = name;
+	pass.m_Execute = std::move(execute);
+	return pass;
+}
+
+void RenderGraph::Export(Handle resource, Access access)
+{
+	m_Exports.emplace_back(resource, access);
+}
+
+// while scheduling the transients have no texture yet, their state is keyed by the handle
+uint64_t RenderGraph::StateKey(Handle resource, bool scheduling) const
+{
+	const Resource& r = m_Resources[resource];
+	if (r.transient && scheduling) {
+		return (uint64_t(2) << 32) | resource;
+	}
+	return (uint64_t(r.texture ? 1 : 0) << 32) | r.id;
+}
+
+// a pass writing a resource with TRANSFER resets it (clear / upload) before its shaders touch it,
+// the GL command is ordered before the shaders so only the update barrier is needed for the earlier writes
+bool RenderGraph::IsReset(const Pass& pass, Handle resource)
+{
+	return std::any_of(pass.m_Accesses.begin(), pass.m_Accesses.end(), [&](const Pass::ResourceAccess& access) {
+		return access.resource == resource && access.write && access.access == Access::TRANSFER;
+	});
+}
+
+GLbitfield RenderGraph::RequiredBarrier(const Pass& pass, const HazardStates& states, bool scheduling) const
+{
+	GLbitfield bits = 0;
+	for (const Pass::ResourceAccess& access : pass.m_Accesses) {
+		auto it = states.find(StateKey(access.resource, scheduling));
+		if (it == states.end() || !it->second.pending_write) {
+			continue;
+		}
+		if (access.access != Access::TRANSFER && IsReset(pass, access.resource)) {
+			continue;
+		}
+		GLbitfield bit = barrierBit(access.access, m_Resources[access.resource].texture);
+		if ((it->second.visible_bits & bit) == 0) {
+			bits |= bit;
+		}
+	}
+	return bits;
+}
+
+void RenderGraph::IssueBarrier(GLbitfield bits, HazardStates& states) const
+{
+	for (auto& state : states) {
+		if (state.second.pending_write) {
+			state.second.visible_bits |= bits;
+		}
+	}
+}
+
+void RenderGraph::MarkWrites(const Pass& pass, HazardStates& states, bool scheduling) const
+{
+	for (const Pass::ResourceAccess& access : pass.m_Accesses) {
+		if (access.write && isShaderWrite(access.access)) {
+			states[StateKey(access.resource, scheduling)] = { true, 0 };
+		}
+	}
+}
+
+/**
+* List scheduling over the dependencies in the order the passes were added:
+* among the passes whose dependencies already ran, the first one which needs no barrier runs next,
+* otherwise the first one added (so without a reason to reorder, the passes run in the order they were added).
+*/
+std::vector<unsigned int> RenderGraph::Schedule() const
+{
+	size_t pass_count = m_Passes.size();
+	std::vector<std::vector<unsigned int>> successors(pass_count);
+	std::vector<unsigned int> remaining_dependencies(pass_count, 0);
+
+	for (unsigned int j = 0; j < pass_count; j++) {
+		for (unsigned int i = 0; i < j; i++) {
+			bool conflict = false;
+			for (const Pass::ResourceAccess& a : m_Passes[i].m_Accesses) {
+				for (const Pass::ResourceAccess& b : m_Passes[j].m_Accesses) {
+					conflict |= a.resource == b.resource && (a.write || b.write);
+				}
+			}
+			if (conflict) {
+				successors[i].push_back(j);
+				remaining_dependencies[j]++;
+			}
+		}
+	}
+
+	HazardStates states = m_States;
+
+	std::vector<unsigned int> ready;
+	for (unsigned int i = 0; i < pass_count; i++) {
+		if (remaining_dependencies[i] == 0) {
+			ready.push_back(i);
+		}
+	}
+
+	std::vector<unsigned int> order;
+	order.reserve(pass_count);
+	while (!ready.empty()) {
+		std::sort(ready.begin(), ready.end());
+		auto next = std::find_if(ready.begin(), ready.end(), [&](unsigned int pass) {
+			return RequiredBarrier(m_Passes[pass], states, true) == 0;
+		});
+		if (next == ready.end()) {
+			next = ready.begin();
+		}
+		unsigned int pass = *next;
+		ready.erase(next);
+
+		IssueBarrier(RequiredBarrier(m_Passes[pass], states, true), states);
+		MarkWrites(m_Passes[pass], states, true);
+		order.push_back(pass);
+
+		for (unsigned int successor : successors[pass]) {
+			if (--remaining_dependencies[successor] == 0) {
+				ready.push_back(successor);
+			}
+		}
+	}
+	return order;
+}
+
+void RenderGraph::AllocateTransients(const std::vector<unsigned int>& order)
+{
+	for (Resource& resource : m_Resources) {
+		resource.first_pass = -1;
+		resource.last_pass = -1;
+	}
+	for (int position = 0; position < (int)order.size(); position++) {
+		for (const Pass::ResourceAccess& access : m_Passes[order[position]].m_Accesses) {
+			Resource& resource = m_Resources[access.resource];
+			if (resource.first_pass < 0) {
+				resource.first_pass = position;
+			}
+			resource.last_pass = position;
+		}
+	}
+	for (const auto& exported : m_Exports) {
+		m_Resources[exported.first].last_pass = (int)order.size(); // lives past the graph
+	}
+
+	std::vector<Handle> transients;
+	for (Handle handle = 0; handle < m_Resources.size(); handle++) {
+		if (m_Resources[handle].transient && m_Resources[handle].first_pass >= 0) {
+			transients.push_back(handle);
+		}
+	}
+	std::sort(transients.begin(), transients.end(), [&](Handle a, Handle b) { return m_Resources[a].first_pass < m_Resources[b].first_pass; });
+
+	for (PooledTexture& pooled : m_TexturePool) {
+		pooled.busy_until = -1;
+	}
+	for (Handle handle : transients) {
+		Resource& resource = m_Resources[handle];
+		auto pooled = std::find_if(m_TexturePool.begin(), m_TexturePool.end(), [&](const PooledTexture& texture) {
+			return texture.width == resource.width && texture.height == resource.height && texture.busy_until < resource.first_pass;
+		});
+		if (pooled == m_TexturePool.end()) {
+			PooledTexture texture = { 0, resource.width, resource.height, -1, 0 };
+			GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &texture.id));
+			GLCall(glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+			GLCall(glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+			GLCall(glTextureStorage2D(texture.id, 1, GL_RGBA32F, resource.width, resource.height));
+			m_TexturePool.push_back(texture);
+			pooled = m_TexturePool.end() - 1;
+		}
+		pooled->busy_until = resource.last_pass;
+		resource.id = pooled->id;
+	}
+
+	// textures no transient needed for a while are released (e.g. a feature was turned off or the viewport resized)
+	for (PooledTexture& pooled : m_TexturePool) {
+		pooled.unused_frames = pooled.busy_until < 0 ? pooled.unused_frames + 1 : 0;
+		if (pooled.unused_frames > max_unused_frames) {
+			GLCall(glDeleteTextures(1, &pooled.id));
+			m_States.erase((uint64_t(1) << 32) | pooled.id);
+		}
+	}
+	m_TexturePool.erase(std::remove_if(m_TexturePool.begin(), m_TexturePool.end(), [](const PooledTexture& pooled) {
+		return pooled.unused_frames > max_unused_frames;
+	}), m_TexturePool.end());
+}
+
+void RenderGraph::Execute()
+{
+	PROFILE_SCOPE("RenderGraph::Execute");
+
+	std::vector<unsigned int> order = Schedule();
+	AllocateTransients(order);
+
+	m_LastBarrierCount = 0;
+	for (unsigned int pass_index : order) {
+		const Pass& pass = m_Passes[pass_index];
+
+		GLbitfield barrier = RequiredBarrier(pass, m_States, false);
+		if (barrier != 0) {
+			GLCall(glMemoryBarrier(barrier));
+			IssueBarrier(barrier, m_States);
+			m_LastBarrierCount++;
+		}
+
+		for (const Pass::ResourceAccess& access : pass.m_Accesses) {
+			if (access.access == Access::IMAGE && access.binding >= 0) {
+				GLCall(glBindImageTexture(access.binding, m_Resources[access.resource].id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
+			}
+		}
+
+		{
+			PROFILE_SCOPE(pass.m_Name);
+			if (m_Profiler) { m_Profiler->BeginZone(pass.m_Name); }
+			pass.m_Execute();
+			if (m_Profiler) { m_Profiler->EndZone(); }
+		}
+
+		MarkWrites(pass, m_States, false);
+	}
+
+	// the accesses after the graph
+	GLbitfield export_barrier = 0;
+	for (const auto& exported : m_Exports) {
+		Pass consumer;
+		consumer.m_Accesses.push_back({ exported.first, exported.second, false, -1 });
+		export_barrier |= RequiredBarrier(consumer, m_States, false);
+	}
+	if (export_barrier != 0) {
+		GLCall(glMemoryBarrier(export_barrier));
+		IssueBarrier(export_barrier, m_States);
+		m_LastBarrierCount++;
+	}
+
+	m_Passes.clear();
+	m_Resources.clear();
+	m_Exports.clear();
+}
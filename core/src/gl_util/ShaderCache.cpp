@@ -0,0 +1,136 @@
+#include "core/gl_util/ShaderCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "core/gl_util/OpenGLdebugFuncs.h"
+
+#ifndef CORE_SHADER_CACHE_PATH
+#define CORE_SHADER_CACHE_PATH "./shader_cache/"
+#endif
+
+namespace {
+	// FNV-1a (64 bit)
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t hashGLString(GLenum name, uint64_t hash)
+	{
+		const char* value = reinterpret_cast<const char*>(glGetString(name));
+		if (value == nullptr) {
+			return hash;
+		}
+		return hashBytes(value, std::char_traits<char>::length(value), hash);
+	}
+
+	struct CacheFileHeader {
+		char magic[8];
+		GLenum binary_format;
+		uint32_t binary_size;
+	};
+
+	const char cache_magic[8] = { 'R', 'T', 'S', 'H', 'B', 'I', 'N', '1' };
+}
+
+uint64_t ShaderCache::ComputeKey(const std::string& expanded_source)
+{
+	uint64_t hash = hashBytes(expanded_source.data(), expanded_source.size());
+	hash = hashGLString(GL_VENDOR, hash);
+	hash = hashGLString(GL_RENDERER, hash);
+	hash = hashGLString(GL_VERSION, hash);
+	return hash;
+}
+
+std::string ShaderCache::GetPath(uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return std::string(CORE_SHADER_CACHE_PATH) + name;
+}
+
+unsigned int ShaderCache::Load(uint64_t key)
+{
+	std::ifstream file(GetPath(key), std::ios::binary);
+	if (!file.is_open()) {
+		return 0;
+	}
+
+	CacheFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !std::equal(cache_magic, cache_magic + 8, header.magic)) {
+		return 0;
+	}
+	// the binary fills the rest of the file, anything else is a damaged file (and mustn't size the allocation)
+	std::streamoff binary_offset = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remaining = file.tellg() - binary_offset;
+	if (binary_offset < 0 || header.binary_size == 0 || remaining != (std::streamoff)header.binary_size) {
+		return 0;
+	}
+	file.seekg(binary_offset);
+
+	std::vector<char> binary(header.binary_size);
+	if (!file.read(binary.data(), binary.size()) || file.gcount() != (std::streamsize)binary.size()) {
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	GLCall(glProgramBinary(program, header.binary_format, binary.data(), (GLsizei)binary.size()));
+
+	// the driver may reject binaries (e.g. after an update which didn't change the version string)
+	int link_status = GL_FALSE;
+	GLCall(glGetProgramiv(program, GL_LINK_STATUS, &link_status));
+	if (link_status == GL_FALSE) {
+		GLCall(glDeleteProgram(program));
+		return 0;
+	}
+	return program;
+}
+
+void ShaderCache::Store(unsigned int program, uint64_t key)
+{
+	int binary_formats = 0;
+	GLCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats));
+	if (binary_formats == 0) {
+		return; // the driver can't return program binaries
+	}
+
+	int binary_size = 0;
+	GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size));
+	if (binary_size <= 0) {
+		return;
+	}
+
+	CacheFileHeader header;
+	std::copy(cache_magic, cache_magic + 8, header.magic);
+	std::vector<char> binary(binary_size);
+	GLCall(glGetProgramBinary(program, binary_size, nullptr, &header.binary_format, binary.data()));
+	header.binary_size = (uint32_t)binary_size;
+
+	std::error_code error;
+	std::filesystem::create_directories(CORE_SHADER_CACHE_PATH, error);
+
+	// written to a temporary file first so a crash never leaves a truncated binary behind
+	std::string path = GetPath(key);
+	std::string temporary_path = path + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "Failed to write the shader cache file " << temporary_path << std::endl;
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), binary.size());
+	}
+	std::filesystem::rename(temporary_path, path, error);
+}
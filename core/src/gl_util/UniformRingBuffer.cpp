@@ -0,0 +1,57 @@
+#include "core/gl_util/UniformRingBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+UniformRingBuffer::UniformRingBuffer(size_t block_size, unsigned int binding_point, unsigned int slot_count)
+	: m_RendererID(0), m_BindingPoint(binding_point),
+	m_BlockSize(block_size), m_SlotStride(0), m_SlotCount(slot_count), m_CurrentSlot(slot_count - 1),
+	m_MappedPtr(nullptr), m_Fences(slot_count, nullptr)
+{
+	int offset_alignment = 256;
+	GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment));
+	m_SlotStride = (m_BlockSize + offset_alignment - 1) / offset_alignment * offset_alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLCall(glCreateBuffers(1, &m_RendererID));
+	GLCall(glNamedBufferStorage(m_RendererID, m_SlotStride * m_SlotCount, nullptr, flags));
+	m_MappedPtr = (unsigned char*)glMapNamedBufferRange(m_RendererID, 0, m_SlotStride * m_SlotCount, flags);
+
+	if (m_MappedPtr == nullptr) { std::cout << "Error mapping uniform ring buffer" << std::endl; }
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+	for (GLsync fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	GLCall(glUnmapNamedBuffer(m_RendererID));
+	GLCall(glDeleteBuffers(1, &m_RendererID));
+}
+
+void UniformRingBuffer::Push(const void* block)
+{
+	// every command reading the current slot has been issued by now, fence it before moving on
+	if (m_Fences[m_CurrentSlot] != nullptr) {
+		glDeleteSync(m_Fences[m_CurrentSlot]);
+	}
+	m_Fences[m_CurrentSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_CurrentSlot = (m_CurrentSlot + 1) % m_SlotCount;
+
+	GLsync& fence = m_Fences[m_CurrentSlot];
+	if (fence != nullptr) {
+		// the GPU normally finished with this slot frames ago so this returns immediately
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	size_t offset = m_SlotStride * m_CurrentSlot;
+	if (m_MappedPtr != nullptr) {
+		std::memcpy(m_MappedPtr + offset, block, m_BlockSize);
+	}
+	GLCall(glBindBufferRange(GL_UNIFORM_BUFFER, m_BindingPoint, m_RendererID, offset, m_BlockSize));
+}
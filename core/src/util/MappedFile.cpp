@@ -0,0 +1,80 @@
+#include "core/util/MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filepath)
+	: m_Data(nullptr), m_Size(0), m_FileHandle(INVALID_HANDLE_VALUE), m_MappingHandle(nullptr)
+{
+	m_FileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE) {
+		std::cerr << "MappedFile - could not open: " << filepath << std::endl;
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_FileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		return; // empty files can't be mapped
+	}
+
+	m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_MappingHandle == nullptr) {
+		std::cerr << "MappedFile - could not create a mapping for: " << filepath << std::endl;
+		return;
+	}
+
+	m_Data = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (m_Data != nullptr) {
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data != nullptr) { UnmapViewOfFile(m_Data); }
+	if (m_MappingHandle != nullptr) { CloseHandle(m_MappingHandle); }
+	if (m_FileHandle != INVALID_HANDLE_VALUE) { CloseHandle(m_FileHandle); }
+}
+#else
+MappedFile::MappedFile(const std::string& filepath)
+	: m_Data(nullptr), m_Size(0), m_FileDescriptor(-1)
+{
+	m_FileDescriptor = open(filepath.c_str(), O_RDONLY);
+	if (m_FileDescriptor == -1) {
+		std::cerr << "MappedFile - could not open: " << filepath << std::endl;
+		return;
+	}
+
+	struct stat fileStats;
+	if (fstat(m_FileDescriptor, &fileStats) != 0 || fileStats.st_size == 0) {
+		return; // empty files can't be mapped
+	}
+
+	void* mapping = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+	if (mapping == MAP_FAILED) {
+		std::cerr << "MappedFile - could not map: " << filepath << std::endl;
+		return;
+	}
+	madvise(mapping, static_cast<size_t>(fileStats.st_size), MADV_SEQUENTIAL);
+
+	m_Data = static_cast<const char*>(mapping);
+	m_Size = static_cast<size_t>(fileStats.st_size);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data != nullptr) { munmap(const_cast<char*>(m_Data), m_Size); }
+	if (m_FileDescriptor != -1) { close(m_FileDescriptor); }
+}
+#endif
@@ -0,0 +1,124 @@
+#include "core/util/Parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "core/util/Profiler.h"
+
+namespace {
+
+    // the tasks of one forEach call, shared by the caller and the pool threads helping with it
+    struct Batch {
+        const std::function<void(size_t)>* task = nullptr;  // only dereferenced for a task index which is not done yet
+        size_t task_count = 0;
+        std::atomic<size_t> next_task{ 0 };
+        std::atomic<size_t> done_tasks{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    // runs tasks of the batch until every one of them was taken
+    void work(Batch& batch)
+    {
+        for (size_t i = batch.next_task++; i < batch.task_count; i = batch.next_task++) {
+            (*batch.task)(i);
+            if (++batch.done_tasks == batch.task_count) {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                batch.finished.notify_all();
+            }
+        }
+    }
+
+    /*
+        The queue holds one entry per requested helper of a batch, an entry whose batch was already
+        taken apart by others returns right away. The threads are never joined, they wait for work
+        until the process exits (the pool is intentionally leaked, see pool()).
+    */
+    class Pool {
+    public:
+        Pool()
+        {
+            for (unsigned int i = 1; i < Parallel::workerCount(); i++) {
+                std::thread(&Pool::workerLoop, this).detach();
+            }
+        }
+
+        void submit(const std::shared_ptr<Batch>& batch, size_t helper_count)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                for (size_t i = 0; i < helper_count; i++) {
+                    m_Queue.push_back(batch);
+                }
+            }
+            m_WorkAvailable.notify_all();
+        }
+
+        // runs one queued entry on the calling thread, returns false if the queue was empty
+        bool runPending()
+        {
+            std::shared_ptr<Batch> batch;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (m_Queue.empty()) {
+                    return false;
+                }
+                batch = std::move(m_Queue.front());
+                m_Queue.pop_front();
+            }
+            work(*batch);
+            return true;
+        }
+
+    private:
+        void workerLoop()
+        {
+            Profiler::setThreadName("Parallel worker");
+            while (true)
+            {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_WorkAvailable.wait(lock, [this]() { return !m_Queue.empty(); });
+                    batch = std::move(m_Queue.front());
+                    m_Queue.pop_front();
+                }
+                PROFILE_SCOPE("Parallel::forEach worker");
+                work(*batch);
+            }
+        }
+
+        std::mutex m_Mutex;
+        std::condition_variable m_WorkAvailable;
+        std::deque<std::shared_ptr<Batch>> m_Queue;
+    };
+
+    Pool& pool()
+    {
+        static Pool* instance = new Pool(); // never destroyed, the detached threads use it until the process exits
+        return *instance;
+    }
+}
+
+void Parallel::detail::run(size_t task_count, const std::function<void(size_t)>& task)
+{
+    auto batch = std::make_shared<Batch>();
+    batch->task = &task;
+    batch->task_count = task_count;
+
+    pool().submit(batch, std::min<size_t>(workerCount(), task_count) - 1);
+    work(*batch); // the calling thread helps as well
+
+    // the last tasks may still run on other threads, meanwhile the caller picks up queued work
+    // (the tasks of calls nested in them) instead of idling
+    while (batch->done_tasks < task_count)
+    {
+        if (!pool().runPending()) {
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->finished.wait(lock, [&]() { return batch->done_tasks == task_count; });
+        }
+    }
+}
@@ -0,0 +1,187 @@
+#include "core/util/Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+    struct Zone {
+        const char* name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+        uint32_t thread_id;
+    };
+
+    /*
+        A ring of zones written by a single thread. The buffers outlive their threads
+        (Parallel spawns short lived workers), a buffer of an exited thread is reused by the next new thread,
+        the zones keep the id of the thread which recorded them.
+        The mutex is only contended while the zones are exported or cleared, zones still closing then wait for it.
+    */
+    struct ThreadBuffer {
+        static const size_t capacity = 1 << 16;
+
+        std::mutex mutex;                   // guards zones and written
+        std::vector<Zone> zones = std::vector<Zone>(capacity);
+        size_t written = 0;                 // total zones written, the ring holds the last min(written, capacity)
+        std::atomic<bool> in_use{ true };
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        std::vector<std::pair<uint32_t, std::string>> thread_names;
+        std::atomic<uint32_t> next_thread_id{ 1 };
+        std::atomic<bool> recording{ false };
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // returns the buffer to the registry when its thread exits
+    struct ThreadSlot {
+        ThreadBuffer* buffer = nullptr;
+        uint32_t thread_id = 0;
+
+        ~ThreadSlot()
+        {
+            if (buffer != nullptr) {
+                buffer->in_use = false;
+            }
+        }
+    };
+
+    thread_local ThreadSlot thread_slot;
+
+    ThreadSlot& currentThread()
+    {
+        if (thread_slot.buffer == nullptr) {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            thread_slot.thread_id = reg.next_thread_id++;
+            for (std::unique_ptr<ThreadBuffer>& buffer : reg.buffers) {
+                if (!buffer->in_use) {
+                    buffer->in_use = true;
+                    thread_slot.buffer = buffer.get();
+                    break;
+                }
+            }
+            if (thread_slot.buffer == nullptr) {
+                reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+                thread_slot.buffer = reg.buffers.back().get();
+            }
+        }
+        return thread_slot;
+    }
+
+    void writeEscaped(std::ostream& stream, const char* text)
+    {
+        for (const char* c = text; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                stream << '\\';
+            }
+            stream << *c;
+        }
+    }
+}
+
+void Profiler::setRecording(bool recording)
+{
+    registry().recording.store(recording, std::memory_order_relaxed);
+}
+
+bool Profiler::isRecording()
+{
+    return registry().recording.load(std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    uint32_t thread_id = currentThread().thread_id;
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.thread_names.emplace_back(thread_id, name);
+}
+
+void Profiler::clear()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (std::unique_ptr<ThreadBuffer>& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->written = 0;
+    }
+}
+
+uint64_t Profiler::nowNs()
+{
+    // + 1 so a valid timestamp is never 0 (ScopedZone uses 0 as "not recording")
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count()) + 1;
+}
+
+void Profiler::recordZone(const char* name, uint64_t begin_ns, uint64_t end_ns)
+{
+    // the zone may have been opened before the recording was paused
+    if (!isRecording()) {
+        return;
+    }
+
+    ThreadSlot& slot = currentThread();
+    std::lock_guard<std::mutex> lock(slot.buffer->mutex);
+    slot.buffer->zones[slot.buffer->written % ThreadBuffer::capacity] = { name, begin_ns, end_ns, slot.thread_id };
+    slot.buffer->written++;
+}
+
+bool Profiler::exportChromeTrace(const std::string& filepath)
+{
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cout << "Failed to write the CPU trace " << filepath << std::endl;
+        return false;
+    }
+
+    bool was_recording = isRecording();
+    setRecording(false);
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& thread_name : reg.thread_names) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread_name.first << ",\"args\":{\"name\":\"";
+        writeEscaped(file, thread_name.second.c_str());
+        file << "\"}}";
+        first = false;
+    }
+
+    file.precision(3);
+    file << std::fixed;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        size_t written = buffer->written;
+        size_t begin = written > ThreadBuffer::capacity ? written - ThreadBuffer::capacity : 0;
+        for (size_t i = begin; i < written; i++) {
+            const Zone& zone = buffer->zones[i % ThreadBuffer::capacity];
+            // complete events ("X"), timestamps in microseconds
+            file << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(file, zone.name);
+            file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.thread_id
+                << ",\"ts\":" << zone.begin_ns / 1.0e3 << ",\"dur\":" << (zone.end_ns - zone.begin_ns) / 1.0e3 << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+
+    setRecording(was_recording);
+    return true;
+}